@@ -12,7 +12,7 @@ namespace pull_star_bench {
 class RegExBench : public dsl_bench::Benchmark {
  public:
   RegExBench(const std::string& input_file, bool construct, int data_structure,
-             int executor_type);
+             int executor_type, int sample_rate = 0);
 
   RegExBench(int executor_type);
 
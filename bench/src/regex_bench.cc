@@ -12,11 +12,14 @@
 #include "text/suffix_tree_index.h"
 #include "text/suffix_array_index.h"
 #include "text/ngram_index.h"
+#include "text/multigram_index.h"
+#include "text/sparse_suffix_array_index.h"
+#include "text/scan_index.h"
 #include "regex_executor.h"
 
 pull_star_bench::RegExBench::RegExBench(const std::string& input_file,
                                         bool construct, int data_structure,
-                                        int executor_type)
+                                        int executor_type, int sample_rate)
     : dsl_bench::Benchmark() {
   if (construct) {
     std::ifstream input_stream(input_file);
@@ -31,7 +34,12 @@ pull_star_bench::RegExBench::RegExBench(const std::string& input_file,
       text_idx_->serialize(out);
       out.close();
     } else if (data_structure == 1) {
-      text_idx_ = new dsl::CompressedSuffixTree(input_text, input_file);
+      text_idx_ = new dsl::CompressedSuffixTree(input_text, sample_rate);
+
+      // Serialize to disk for future use.
+      std::ofstream out(input_file + ".cst");
+      text_idx_->serialize(out);
+      out.close();
     } else if (data_structure == 2) {
       text_idx_ = new dsl::SuffixArrayIndex(input_text);
 
@@ -53,6 +61,22 @@ pull_star_bench::RegExBench::RegExBench(const std::string& input_file,
       std::ofstream out(input_file + ".ngm");
       text_idx_->serialize(out);
       out.close();
+    } else if (data_structure == 5) {
+      text_idx_ = new dsl::SparseSuffixArrayIndex(input_text);
+
+      // Serialize to disk for future use.
+      std::ofstream out(input_file + ".ssa");
+      text_idx_->serialize(out);
+      out.close();
+    } else if (data_structure == 6) {
+      text_idx_ = new dsl::ScanIndex(input_text);
+    } else if (data_structure == 7) {
+      text_idx_ = new dsl::MultiGramIndex(input_text);
+
+      // Serialize to disk for future use.
+      std::ofstream out(input_file + ".mgm");
+      text_idx_->serialize(out);
+      out.close();
     } else {
       fprintf(stderr, "Data structure %d not supported yet.\n", data_structure);
       exit(0);
@@ -64,11 +88,9 @@ pull_star_bench::RegExBench::RegExBench(const std::string& input_file,
       text_idx_->deserialize(input_stream);
       input_stream.close();
     } else if (data_structure == 1) {
-      std::ifstream input_stream(input_file);
-      const std::string input_text(
-          (std::istreambuf_iterator<char>(input_stream)),
-          std::istreambuf_iterator<char>());
-      text_idx_ = new dsl::CompressedSuffixTree(input_text, input_file, false);
+      std::ifstream input_stream(input_file + ".cst");
+      text_idx_ = new dsl::CompressedSuffixTree();
+      text_idx_->deserialize(input_stream);
       input_stream.close();
     } else if (data_structure == 2) {
       std::ifstream input_stream(input_file + ".sa");
@@ -85,6 +107,23 @@ pull_star_bench::RegExBench::RegExBench(const std::string& input_file,
       text_idx_ = new dsl::NGramIndex();
       text_idx_->deserialize(input_stream);
       input_stream.close();
+    } else if (data_structure == 5) {
+      std::ifstream input_stream(input_file + ".ssa");
+      text_idx_ = new dsl::SparseSuffixArrayIndex();
+      text_idx_->deserialize(input_stream);
+      input_stream.close();
+    } else if (data_structure == 6) {
+      std::ifstream input_stream(input_file);
+      const std::string input_text(
+          (std::istreambuf_iterator<char>(input_stream)),
+          std::istreambuf_iterator<char>());
+      text_idx_ = new dsl::ScanIndex(input_text);
+      input_stream.close();
+    } else if (data_structure == 7) {
+      std::ifstream input_stream(input_file + ".mgm");
+      text_idx_ = new dsl::MultiGramIndex();
+      text_idx_->deserialize(input_stream);
+      input_stream.close();
     } else {
       fprintf(stderr, "Data structure %d not supported yet.\n", data_structure);
       exit(0);
@@ -294,12 +333,12 @@ void pull_star_bench::RegExBench::benchBreakdown(
 void print_usage(char *exec) {
   fprintf(
       stderr,
-      "Usage: %s [-t] [-m mode] [-q query_file] [-r res_file] [-d data_structure] [-e executor_type] [-b benchmark] [file]\n",
+      "Usage: %s [-t] [-m mode] [-q query_file] [-r res_file] [-d data_structure] [-e executor_type] [-s sample_rate] [-b benchmark] [file]\n",
       exec);
 }
 
 int main(int argc, char **argv) {
-  if (argc < 2 || argc > 17) {
+  if (argc < 2 || argc > 19) {
     print_usage(argv[0]);
     return -1;
   }
@@ -313,8 +352,9 @@ int main(int argc, char **argv) {
   int data_structure = 0;
   int executor_type = 1;
   int port = 11000;
+  int sample_rate = 0;
 
-  while ((c = getopt(argc, argv, "m:tq:r:d:e:p:b:")) != -1) {
+  while ((c = getopt(argc, argv, "m:tq:r:d:e:p:s:b:")) != -1) {
     switch (c) {
       case 'm': {
         construct = atoi(optarg);
@@ -344,6 +384,10 @@ int main(int argc, char **argv) {
         port = atoi(optarg);
         break;
       }
+      case 's': {
+        sample_rate = atoi(optarg);
+        break;
+      }
       case 'b': {
         benchmark = std::string(optarg);
         break;
@@ -371,7 +415,8 @@ int main(int argc, char **argv) {
     std::string input_file = std::string(argv[optind]);
 
     bench = new pull_star_bench::RegExBench(input_file, construct,
-                                            data_structure, executor_type);
+                                            data_structure, executor_type,
+                                            sample_rate);
     if (benchmark == "latency-regex") {
       bench->benchRegex(query_file, res_file);
     } else if (benchmark == "latency-search") {
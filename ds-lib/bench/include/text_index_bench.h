@@ -29,8 +29,47 @@ class TextIndexBench : public Benchmark {
   void benchCount(const std::string& query_file,
                   const std::string& result_path) const;
 
+  /**
+   * Benchmark binary, bucketed and learned range search on a SuffixArrayIndex.
+   */
+  void benchRangeSearch(const std::string& query_file,
+                        const std::string& result_path) const;
+
+  /**
+   * Benchmark search operation per located occurrence; meant for queries
+   * with many occurrences.
+   */
+  void benchLocate(const std::string& query_file,
+                   const std::string& result_path) const;
+
+  /**
+   * Run every query (search, count and a short charAt scan from the first
+   * occurrence, up to the end of the text) from 1, 2, 4, ... up to num_threads threads sharing this
+   * index, check each thread's answers against a single-threaded run, and
+   * report the aggregate throughput.
+   */
+  void benchConcurrent(const std::string& query_file,
+                       const std::string& result_path,
+                       uint32_t num_threads) const;
+
+  /**
+   * Build a CompressedSuffixTree on input_file for a range of CSA sample
+   * rates, and report index size against count, locate and extract latency.
+   */
+  static void benchSampleRates(const std::string& input_file,
+                               const std::string& query_file,
+                               const std::string& result_path);
+
+  /**
+   * Microbenchmark the bit operations under the succinct structures:
+   * popcount and integer log in dsl::Utils, and rank/select on the
+   * compressed suffix tree's BitRank, over a random bit vector.
+   */
+  static void benchBitOps(const std::string& result_path);
+
  private:
   dsl::TextIndex *text_idx_;
+  uint64_t text_size_;
 };
 
 }
@@ -3,17 +3,30 @@
 #include <unistd.h>
 #include <cstdlib>
 #include <cstdio>
+#include <atomic>
 #include <fstream>
+#include <sstream>
 #include <streambuf>
+#include <thread>
 
 #include "text/suffix_array_index.h"
 #include "text/suffix_tree_index.h"
 #include "text/compressed_suffix_tree.h"
 #include "text/ngram_index.h"
+#include "text/multigram_index.h"
+#include "text/sparse_suffix_array_index.h"
+#include "text/scan_index.h"
+#include "utils.h"
+#include "BitRank.h"
 
 dsl_bench::TextIndexBench::TextIndexBench(const std::string& input_file,
                                           bool construct, int data_structure)
     : Benchmark() {
+  // Loaded indexes do not all keep the text size, so take it from the input.
+  std::ifstream size_stream(input_file, std::ios::binary | std::ios::ate);
+  text_size_ = size_stream ? (uint64_t) size_stream.tellg() : 0;
+  size_stream.close();
+
   if (construct) {
     std::ifstream input_stream(input_file);
     const std::string input_text((std::istreambuf_iterator<char>(input_stream)),
@@ -27,7 +40,12 @@ dsl_bench::TextIndexBench::TextIndexBench(const std::string& input_file,
       text_idx_->serialize(out);
       out.close();
     } else if (data_structure == 1) {
-      text_idx_ = new dsl::CompressedSuffixTree(input_text, input_file);
+      text_idx_ = new dsl::CompressedSuffixTree(input_text);
+
+      // Serialize to disk for future use.
+      std::ofstream out(input_file + ".cst");
+      text_idx_->serialize(out);
+      out.close();
     } else if (data_structure == 2) {
       text_idx_ = new dsl::SuffixArrayIndex(input_text);
 
@@ -49,6 +67,22 @@ dsl_bench::TextIndexBench::TextIndexBench(const std::string& input_file,
       std::ofstream out(input_file + ".ngm");
       text_idx_->serialize(out);
       out.close();
+    } else if (data_structure == 5) {
+      text_idx_ = new dsl::SparseSuffixArrayIndex(input_text);
+
+      // Serialize to disk for future use.
+      std::ofstream out(input_file + ".ssa");
+      text_idx_->serialize(out);
+      out.close();
+    } else if (data_structure == 6) {
+      text_idx_ = new dsl::ScanIndex(input_text);
+    } else if (data_structure == 7) {
+      text_idx_ = new dsl::MultiGramIndex(input_text);
+
+      // Serialize to disk for future use.
+      std::ofstream out(input_file + ".mgm");
+      text_idx_->serialize(out);
+      out.close();
     } else {
       fprintf(stderr, "Data structure %d not supported yet.\n", data_structure);
       exit(0);
@@ -60,11 +94,9 @@ dsl_bench::TextIndexBench::TextIndexBench(const std::string& input_file,
       text_idx_->deserialize(input_stream);
       input_stream.close();
     } else if (data_structure == 1) {
-      std::ifstream input_stream(input_file);
-      const std::string input_text(
-          (std::istreambuf_iterator<char>(input_stream)),
-          std::istreambuf_iterator<char>());
-      text_idx_ = new dsl::CompressedSuffixTree(input_text, input_file, false);
+      std::ifstream input_stream(input_file + ".cst");
+      text_idx_ = new dsl::CompressedSuffixTree();
+      text_idx_->deserialize(input_stream);
       input_stream.close();
     } else if (data_structure == 2) {
       std::ifstream input_stream(input_file + ".sa");
@@ -81,6 +113,23 @@ dsl_bench::TextIndexBench::TextIndexBench(const std::string& input_file,
       text_idx_ = new dsl::NGramIndex();
       text_idx_->deserialize(input_stream);
       input_stream.close();
+    } else if (data_structure == 5) {
+      std::ifstream input_stream(input_file + ".ssa");
+      text_idx_ = new dsl::SparseSuffixArrayIndex();
+      text_idx_->deserialize(input_stream);
+      input_stream.close();
+    } else if (data_structure == 6) {
+      std::ifstream input_stream(input_file);
+      const std::string input_text(
+          (std::istreambuf_iterator<char>(input_stream)),
+          std::istreambuf_iterator<char>());
+      text_idx_ = new dsl::ScanIndex(input_text);
+      input_stream.close();
+    } else if (data_structure == 7) {
+      std::ifstream input_stream(input_file + ".mgm");
+      text_idx_ = new dsl::MultiGramIndex();
+      text_idx_->deserialize(input_stream);
+      input_stream.close();
     } else {
       fprintf(stderr, "Data structure %d not supported yet.\n", data_structure);
       exit(0);
@@ -124,15 +173,266 @@ void dsl_bench::TextIndexBench::benchCount(
   result_stream.close();
 }
 
+void dsl_bench::TextIndexBench::benchRangeSearch(
+    const std::string& query_file, const std::string& result_path) const {
+  dsl::SuffixArrayIndex *sa_idx =
+      dynamic_cast<dsl::SuffixArrayIndex *>(text_idx_);
+  if (sa_idx == NULL
+      || dynamic_cast<dsl::AugmentedSuffixArrayIndex *>(text_idx_) != NULL) {
+    fprintf(stderr, "Range search benchmark needs a suffix array index.\n");
+    exit(0);
+  }
+
+  std::vector<std::string> queries = readQueryFile(query_file);
+  std::ofstream result_stream(result_path);
+
+  // Lookups take well under a microsecond, so time repeated runs.
+  const int kRepeat = 1000;
+  const char *names[] = { "binary", "bucket", "learned" };
+  for (int type = 0; type < 3; type++) {
+    time_t start = get_timestamp();
+    sa_idx->setRangeSearchType((dsl::SuffixArrayIndex::RangeSearchType) type);
+    time_t build_time = get_timestamp() - start;
+
+    double total = 0;
+    for (auto query : queries) {
+      int64_t result = 0;
+      start = get_timestamp();
+      for (int i = 0; i < kRepeat; i++) {
+        result = sa_idx->count(query);
+      }
+      time_t end = get_timestamp();
+      double latency = (double) (end - start) / kRepeat;
+      total += latency;
+      result_stream << names[type] << "\t" << result << "\t" << latency
+                    << "\n";
+    }
+    result_stream.flush();
+    fprintf(stderr, "%s: built in %llu us, average latency %.3f us\n",
+            names[type], build_time,
+            queries.empty() ? 0 : total / queries.size());
+  }
+
+  result_stream.close();
+}
+
+void dsl_bench::TextIndexBench::benchLocate(
+    const std::string& query_file, const std::string& result_path) const {
+  std::vector<std::string> queries = readQueryFile(query_file);
+  std::ofstream result_stream(result_path);
+
+  time_t total_time = 0;
+  uint64_t total_results = 0;
+  for (auto query : queries) {
+    std::vector<int64_t> results;
+    time_t start = get_timestamp();
+    text_idx_->search(results, query);
+    time_t end = get_timestamp();
+    time_t tot = end - start;
+    double per_result = results.empty() ? 0 : 1000.0 * tot / results.size();
+    result_stream << results.size() << "\t" << tot << "\t" << per_result
+                  << "\n";
+    total_time += tot;
+    total_results += results.size();
+  }
+  fprintf(stderr, "Located %llu occurrences in %llu us (%.1f ns each)\n",
+          (unsigned long long) total_results, total_time,
+          total_results ? 1000.0 * total_time / total_results : 0);
+
+  result_stream.close();
+}
+
+// Checksum of everything the queries return, so that answers from
+// concurrent runs can be compared with a single-threaded one.
+static uint64_t runQueries(const dsl::TextIndex *text_idx,
+                           uint64_t text_size,
+                           const std::vector<std::string>& queries,
+                           std::vector<uint64_t>& checksums) {
+  const uint64_t kScanChars = 64;
+  uint64_t num_results = 0;
+  for (size_t i = 0; i < queries.size(); i++) {
+    std::vector<int64_t> results;
+    text_idx->search(results, queries[i]);
+    uint64_t sum = text_idx->count(queries[i]) * 31 + results.size();
+    for (auto result : results) {
+      sum += result;
+    }
+    if (!results.empty()) {
+      for (uint64_t j = 0; j < kScanChars && results[0] + j < text_size;
+          j++) {
+        sum = sum * 31 + (uint8_t) text_idx->charAt(results[0] + j);
+      }
+    }
+    checksums[i] = sum;
+    num_results += results.size();
+  }
+  return num_results;
+}
+
+void dsl_bench::TextIndexBench::benchConcurrent(
+    const std::string& query_file, const std::string& result_path,
+    uint32_t num_threads) const {
+  std::vector<std::string> queries = readQueryFile(query_file);
+  std::ofstream result_stream(result_path);
+  result_stream << "threads\tqueries_per_s\tmismatches\n";
+
+  std::vector<uint64_t> expected(queries.size());
+  runQueries(text_idx_, text_size_, queries, expected);
+
+  for (uint32_t threads = 1; ; threads = MIN(threads * 2, num_threads)) {
+    std::atomic<uint64_t> mismatches(0);
+    auto worker = [&]() {
+      std::vector<uint64_t> checksums(queries.size());
+      runQueries(text_idx_, text_size_, queries, checksums);
+      for (size_t i = 0; i < queries.size(); i++) {
+        if (checksums[i] != expected[i])
+          mismatches++;
+      }
+    };
+
+    time_t start = get_timestamp();
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < threads; i++) {
+      workers.push_back(std::thread(worker));
+    }
+    for (auto& t : workers) {
+      t.join();
+    }
+    time_t tot = get_timestamp() - start;
+
+    double qps = tot ? 1e6 * threads * queries.size() / tot : 0;
+    result_stream << threads << "\t" << qps << "\t" << mismatches << "\n";
+    result_stream.flush();
+    fprintf(stderr, "%u threads: %.0f queries/s, %llu mismatches\n", threads,
+            qps, (unsigned long long) mismatches);
+    if (threads >= num_threads)
+      break;
+  }
+
+  result_stream.close();
+}
+
+void dsl_bench::TextIndexBench::benchSampleRates(
+    const std::string& input_file, const std::string& query_file,
+    const std::string& result_path) {
+  std::ifstream input_stream(input_file);
+  const std::string input_text((std::istreambuf_iterator<char>(input_stream)),
+                               std::istreambuf_iterator<char>());
+  input_stream.close();
+  std::vector<std::string> queries = Benchmark().readQueryFile(query_file);
+  std::ofstream result_stream(result_path);
+  result_stream << "sample_rate\tbytes\tcount_us\tlocate_ns\textract_ns\n";
+
+  // 0 is the default, floor(log2(n)).
+  const uint32_t rates[] = { 0, 4, 8, 16, 32, 64, 128 };
+  const uint64_t kExtractChars = 100000;
+  for (uint32_t rate : rates) {
+    fprintf(stderr, "Constructing compressed suffix tree with sample rate "
+            "%u...\n", rate);
+    dsl::CompressedSuffixTree cst(input_text, rate);
+    std::ostringstream out;
+    size_t bytes = cst.serialize(out);
+
+    time_t start = get_timestamp();
+    for (auto query : queries) {
+      cst.count(query);
+    }
+    time_t count_time = get_timestamp() - start;
+
+    uint64_t num_results = 0;
+    start = get_timestamp();
+    for (auto query : queries) {
+      std::vector<int64_t> results;
+      cst.search(results, query);
+      num_results += results.size();
+    }
+    time_t locate_time = get_timestamp() - start;
+
+    srand(0);
+    // Reported below, which keeps the loop from being optimized away.
+    uint64_t checksum = 0;
+    start = get_timestamp();
+    for (uint64_t i = 0; i < kExtractChars; i++) {
+      checksum += (uint8_t) cst.charAt(rand() % input_text.length());
+    }
+    time_t extract_time = get_timestamp() - start;
+
+    double count_us = queries.empty() ? 0 : (double) count_time / queries.size();
+    double locate_ns = num_results ? 1000.0 * locate_time / num_results : 0;
+    double extract_ns = 1000.0 * extract_time / kExtractChars;
+    result_stream << rate << "\t" << bytes << "\t" << count_us << "\t"
+                  << locate_ns << "\t" << extract_ns << "\n";
+    result_stream.flush();
+    fprintf(stderr, "sample rate %u: %zu bytes, count %.3f us/query, "
+            "locate %.1f ns/occurrence, extract %.1f ns/char (checksum "
+            "%llu)\n", rate, bytes, count_us, locate_ns, extract_ns,
+            (unsigned long long) checksum);
+  }
+
+  result_stream.close();
+}
+
+void dsl_bench::TextIndexBench::benchBitOps(const std::string& result_path) {
+  const uint64_t kNumBits = 1ULL << 26;
+  const uint64_t kNumOps = 1ULL << 22;
+  std::ofstream result_stream(result_path);
+  result_stream << "op\tns\n";
+
+  srand(0);
+  uint64_t num_words = kNumBits / 64 + 1;
+  ulong *bits = new ulong[num_words];
+  for (uint64_t i = 0; i < num_words; i++) {
+    bits[i] = ((uint64_t) rand() << 40) ^ ((uint64_t) rand() << 20) ^ rand();
+  }
+  BitRank bit_rank(bits, kNumBits, true);
+  uint64_t num_ones = bit_rank.rank(kNumBits - 1);
+
+  // Random arguments are drawn up front, so only the operation is timed.
+  std::vector<uint64_t> args(kNumOps);
+  for (uint64_t i = 0; i < kNumOps; i++) {
+    args[i] = ((uint64_t) rand() << 20) ^ rand();
+  }
+
+  const char *ops[] = { "popcount", "int_log_2", "rank", "select", "select0" };
+  for (uint32_t op = 0; op < 5; op++) {
+    // sum is reported below, which keeps the loop from being optimized away.
+    uint64_t sum = 0;
+    time_t start = get_timestamp();
+    for (uint64_t i = 0; i < kNumOps; i++) {
+      uint64_t x = args[i];
+      if (op == 0) {
+        sum += dsl::Utils::popcount(x ^ sum);
+      } else if (op == 1) {
+        sum += dsl::Utils::int_log_2(x ^ sum);
+      } else if (op == 2) {
+        sum += bit_rank.rank(x % kNumBits);
+      } else if (op == 3) {
+        sum += bit_rank.select(x % num_ones + 1);
+      } else {
+        sum += bit_rank.select0(x % (kNumBits - num_ones) + 1);
+      }
+    }
+    time_t op_time = get_timestamp() - start;
+
+    double ns = 1000.0 * op_time / kNumOps;
+    result_stream << ops[op] << "\t" << ns << "\n";
+    fprintf(stderr, "%s: %.2f ns/op (checksum %llu)\n", ops[op], ns,
+            (unsigned long long) sum);
+  }
+
+  result_stream.close();
+}
+
 void print_usage(char *exec) {
   fprintf(
       stderr,
-      "Usage: %s [-m mode] [-t type] [-q query_file] [-r res_file] [file]\n",
+      "Usage: %s [-m mode] [-t type] [-q query_file] [-r res_file] "
+      "[-d data_structure] [-n num_threads] [file]\n",
       exec);
 }
 
 int main(int argc, char **argv) {
-  if (argc < 2 || argc > 8) {
+  if (argc < 2 || argc > 14) {
     print_usage(argv[0]);
     return -1;
   }
@@ -143,8 +443,9 @@ int main(int argc, char **argv) {
   std::string query_file = "queries.txt";
   std::string res_file = "res.txt";
   int data_structure = 0;
+  uint32_t num_threads = 1;
 
-  while ((c = getopt(argc, argv, "m:t:q:r:d:")) != -1) {
+  while ((c = getopt(argc, argv, "m:t:q:r:d:n:")) != -1) {
     switch (c) {
       case 'm': {
         construct = atoi(optarg);
@@ -166,6 +467,10 @@ int main(int argc, char **argv) {
         data_structure = atoi(optarg);
         break;
       }
+      case 'n': {
+        num_threads = MAX(atoi(optarg), 1);
+        break;
+      }
       default: {
         fprintf(stderr, "Unsupported option %c.\n", (char) c);
         exit(0);
@@ -179,12 +484,27 @@ int main(int argc, char **argv) {
   }
 
   std::string input_file = std::string(argv[optind]);
+  if (type == "sweep-samplerate") {
+    dsl_bench::TextIndexBench::benchSampleRates(input_file, query_file,
+                                                res_file);
+    return 0;
+  }
+  if (type == "micro-bitops") {
+    dsl_bench::TextIndexBench::benchBitOps(res_file);
+    return 0;
+  }
   dsl_bench::TextIndexBench bench(input_file, construct, data_structure);
 
   if (type == "latency-search") {
     bench.benchSearch(query_file, res_file);
   } else if (type == "latency-count") {
     bench.benchCount(query_file, res_file);
+  } else if (type == "latency-range") {
+    bench.benchRangeSearch(query_file, res_file);
+  } else if (type == "latency-locate") {
+    bench.benchLocate(query_file, res_file);
+  } else if (type == "stress-threads") {
+    bench.benchConcurrent(query_file, res_file, num_threads);
   } else {
     fprintf(stderr, "Unsupported type %s.\n", type.c_str());
     exit(0);
@@ -4,32 +4,72 @@
 #include <iostream>
 #include <fstream>
 
-#include "suffix_tree.h"
 #include "text/compressed_suffix_tree.h"
 #include "text/suffix_array_index.h"
 #include "text/ngram_index.h"
+#include "text/multigram_index.h"
+#include "text/sparse_suffix_array_index.h"
+#include "text/suffix_tree_index.h"
 
 void print_usage(char *exec) {
   fprintf(
   stderr,
-          "Usage: %s [-d data-structure] [file]\n", exec);
+          "Usage: %s [-d data-structure] [-b boundaries] [-r range-search] "
+          "[-c] [-t num-threads] [-p trie-depth] [-s sample-rate] "
+          "[-m max-postings] [file]\n",
+          exec);
 }
 
 int main(int argc, char **argv) {
-  if (argc < 2 || argc > 4) {
+  if (argc < 2 || argc > 17) {
     print_usage(argv[0]);
     return -1;
   }
 
   int c;
   int data_structure = 0;
+  std::string boundaries = "|\n";
+  int range_search = 0;
+  bool compress_text = false;
+  int num_threads = 1;
+  int trie_depth = 0;
+  int sample_rate = 0;
+  uint64_t max_postings = dsl::MultiGramIndex::kDefaultMaxPostings;
 
-  while ((c = getopt(argc, argv, "d:")) != -1) {
+  while ((c = getopt(argc, argv, "d:b:r:ct:p:s:m:")) != -1) {
     switch (c) {
       case 'd': {
         data_structure = atoi(optarg);
         break;
       }
+      case 'b': {
+        boundaries = std::string(optarg);
+        break;
+      }
+      case 'r': {
+        range_search = atoi(optarg);
+        break;
+      }
+      case 'c': {
+        compress_text = true;
+        break;
+      }
+      case 't': {
+        num_threads = atoi(optarg);
+        break;
+      }
+      case 'p': {
+        trie_depth = atoi(optarg);
+        break;
+      }
+      case 's': {
+        sample_rate = atoi(optarg);
+        break;
+      }
+      case 'm': {
+        max_postings = strtoull(optarg, NULL, 10);
+        break;
+      }
       default: {
         fprintf(stderr, "Unsupported option %c.\n", (char) c);
         exit(0);
@@ -50,31 +90,63 @@ int main(int argc, char **argv) {
   input_stream.close();
   if (data_structure == 0) {
     fprintf(stderr, "Constructing suffix tree...\n");
-    dsl::SuffixTree suffix_tree(input_text);
+    dsl::SuffixTreeIndex suffix_tree(input_text, num_threads);
     std::ofstream out(input_file + ".st");
+    if (compress_text)
+      suffix_tree.compressText();
     suffix_tree.serialize(out);
     out.close();
   } else if (data_structure == 1) {
     fprintf(stderr, "Constructing compressed suffix tree...\n");
-    dsl::CompressedSuffixTree compressed_suffix_tree(input_text, input_file);
+    dsl::CompressedSuffixTree compressed_suffix_tree(input_text, sample_rate);
+    std::ofstream out(input_file + ".cst");
+    compressed_suffix_tree.serialize(out);
+    out.close();
   } else if (data_structure == 2) {
     fprintf(stderr, "Constructing suffix array index...\n");
     dsl::SuffixArrayIndex suffix_array(input_text);
+    suffix_array.setRangeSearchType(
+        (dsl::SuffixArrayIndex::RangeSearchType) range_search);
+    suffix_array.buildPrefixTrie(trie_depth);
     std::ofstream out(input_file + ".sa");
+    if (compress_text)
+      suffix_array.compressText();
     suffix_array.serialize(out);
     out.close();
   } else if (data_structure == 3) {
     fprintf(stderr, "Constructing augmented suffix array index...\n");
     dsl::AugmentedSuffixArrayIndex augmented_suffix_array(input_text);
+    augmented_suffix_array.buildPrefixTrie(trie_depth);
     std::ofstream out(input_file + ".asa");
+    if (compress_text)
+      augmented_suffix_array.compressText();
     augmented_suffix_array.serialize(out);
     out.close();
   } else if (data_structure == 4) {
     fprintf(stderr, "Constructing n-gram index...\n");
     dsl::NGramIndex ngram_index(input_text);
     std::ofstream out(input_file + ".ngm");
+    if (compress_text)
+      ngram_index.compressText();
     ngram_index.serialize(out);
     out.close();
+  } else if (data_structure == 5) {
+    fprintf(stderr, "Constructing sparse suffix array index...\n");
+    dsl::SparseSuffixArrayIndex sparse_suffix_array(input_text, boundaries);
+    std::ofstream out(input_file + ".ssa");
+    sparse_suffix_array.serialize(out);
+    out.close();
+  } else if (data_structure == 6) {
+    fprintf(stderr, "Scan index needs no construction; it is loaded directly "
+            "from %s.\n", input_file.c_str());
+  } else if (data_structure == 7) {
+    fprintf(stderr, "Constructing multigram index...\n");
+    dsl::MultiGramIndex multigram_index(input_text, max_postings);
+    std::ofstream out(input_file + ".mgm");
+    if (compress_text)
+      multigram_index.compressText();
+    multigram_index.serialize(out);
+    out.close();
   } else {
     fprintf(stderr, "Data structure %d not supported yet.\n", data_structure);
     exit(0);
@@ -25,8 +25,12 @@
 /////////////
 //Rank(B,i)// 
 /////////////
-//This Class use a superblock size of 256-512 bits
-//and a block size of 32-64 bits also
+// Rank9 layout (S. Vigna, Broadword implementation of rank/select queries,
+// WEA 2008): every 512 bit block has two words of counts, the number of 1s
+// before the block and seven 9 bit counts of 1s before each word inside the
+// block, so that a rank touches one cache line of counts and one of data.
+// Select binary searches the blocks between two sampled positions of every
+// selectSample:th 1.
 
 
 const unsigned char __popcount_tab[] =
@@ -61,31 +65,44 @@ const unsigned char select_tab[] =
 };
 
 
-// bits needed to represent a number between 0 and n
-inline ulong bits (ulong n){
-	ulong b = 0;
-	while (n) { b++; n >>= 1; }
-	return b;
+inline unsigned popcount8 (register int x){
+  return __popcount_tab[x & 0xff];
 }
 
-#if W == 32
-    // 32 bit version
-    inline unsigned popcount (register ulong x){
-        return __popcount_tab[(x >>  0) & 0xff]  + __popcount_tab[(x >>  8) & 0xff]  + __popcount_tab[(x >> 16) & 0xff] + __popcount_tab[(x >> 24) & 0xff];
-    }
-#else
-    // 64 bit version
-    inline unsigned popcount (register ulong x){
-        return __popcount_tab[(x >>  0) & 0xff]  + __popcount_tab[(x >>  8) & 0xff]  + __popcount_tab[(x >> 16) & 0xff] + __popcount_tab[(x >> 24) & 0xff] + __popcount_tab[(x >> 32) & 0xff] + __popcount_tab[(x >> 40) & 0xff] + __popcount_tab[(x >> 48) & 0xff] + __popcount_tab[(x >> 56) & 0xff];
-    }
+#ifdef BITRANK_DISPATCH
+#include <immintrin.h>
+
+static const bool hasBMI2 = (__builtin_cpu_init(), __builtin_cpu_supports("bmi2"));
+
+__attribute__((target("bmi2")))
+static unsigned selectWordBMI2(ulong x, unsigned r) {
+    return __builtin_ctzl(_pdep_u64(1lu << (r - 1), x));
+}
 #endif
 
-inline unsigned popcount16 (register int x){
-  return __popcount_tab[x & 0xff]  + __popcount_tab[(x >>  8) & 0xff];
+// Position of the r:th 1 in x, r >= 1
+static inline unsigned selectWord(ulong x, unsigned r) {
+#ifdef BITRANK_DISPATCH
+    if (hasBMI2)
+        return selectWordBMI2(x, r);
+#endif
+    unsigned pos = 0, c;
+    while ((c = popcount8(x)) < r) {
+        r -= c;
+        x >>= 8;
+        pos += 8;
+    }
+    while (true) {
+        if ((x & 1lu) && --r == 0)
+            return pos;
+        x >>= 1;
+        pos++;
+    }
 }
 
-inline unsigned popcount8 (register int x){
-  return __popcount_tab[x & 0xff];
+// Count of 1s before word j of a block, from the block's packed counts
+static inline ulong subCount(ulong packed, ulong j) {
+    return (packed >> (((j - 1) & 7) * 9)) & 0x1ff;
 }
 
 BitRank::BitRank(ulong *bitarray, ulong n, bool owner, ReplacePattern *rp) {
@@ -94,13 +111,7 @@ BitRank::BitRank(ulong *bitarray, ulong n, bool owner, ReplacePattern *rp) {
     this->rp = rp;
     this->owner = owner;
     this->n=n;  // length of bitarray in bits
-    b = W; // b is a word
-    s=b*superFactor;
-    ulong aux=(n+1)%W;
-    if (aux != 0)
-        integers = (n+1)/W+1;
-    else 
-        integers = (n+1)/W;
+    integers = n/W+1;
     BuildRank();
     
     if (rp != 0)
@@ -110,211 +121,157 @@ BitRank::BitRank(ulong *bitarray, ulong n, bool owner, ReplacePattern *rp) {
     }
 }
 
+// Load the rank directory written by Save(), adding the number of bytes
+// read to *bytes. If bitarray is null, the bit array is read from the stream
+// as well and owned by the new object.
+BitRank::BitRank(std::istream &in, ulong *bytes, ulong *bitarray, bool owner, ReplacePattern *rp) {
+    *bytes += Tools::Read(in, &n, 1);
+    integers = n/W+1;
+    blocks = (integers + blockWords - 1) / blockWords;
+    if (bitarray == 0)
+    {
+        bitarray = new ulong[integers];
+        *bytes += Tools::Read(in, bitarray, integers);
+        owner = true;
+    }
+    data = bitarray;
+    this->rp = rp;
+    this->owner = owner;
+    counts = new ulong[2 * (blocks + 1)];
+    *bytes += Tools::Read(in, counts, 2 * (blocks + 1));
+    ones = counts[2 * blocks];
+    samples = new ulong[ones / selectSample + 2];
+    *bytes += Tools::Read(in, samples, ones / selectSample + 2);
+}
+
+// Save the rank directory, and the bit array if saveBits is set.
+// Returns the number of bytes written.
+ulong BitRank::Save(std::ostream &out, bool saveBits) {
+    ulong bytes = Tools::Write(out, &n, 1);
+    if (saveBits)
+        bytes += Tools::Write(out, data, integers);
+    bytes += Tools::Write(out, counts, 2 * (blocks + 1));
+    bytes += Tools::Write(out, samples, ones / selectSample + 2);
+    return bytes;
+}
+
 BitRank::~BitRank() {
-    delete [] Rs;
-    delete [] Rb;
+    delete [] counts;
+    delete [] samples;
     if (owner) delete [] data;
 }
 
 //Build the rank (blocks and superblocks)
 void BitRank::BuildRank()
 {
-    ulong num_sblock = n/s;
-    ulong num_block = n/b;
-    Rs = new ulong[num_sblock+1];//+1 we add the 0 pos
-    Rb = new uchar[num_block+1];//+1 we add the 0 pos
-	
-	ulong j;
-    Rs[0] = 0lu;
-	
-    for (j=1;j<=num_sblock;j++) 
+    blocks = (integers + blockWords - 1) / blockWords;
+    counts = new ulong[2 * (blocks + 1)];
+    ulong total = 0;
+    for (ulong k = 0; k < blocks; k++)
+    {
+        ulong packed = 0, sub = 0;
+        for (ulong j = 0; j < blockWords; j++)
         {
-			Rs[j]=BuildRankSub((j-1)*superFactor,superFactor)+Rs[j-1];
-		}
-    
-    Rb[0]=0;
-    for (ulong k=1;k<=num_block;k++) {
-        j = k / superFactor;
-        Rb[k]=BuildRankSub(j*superFactor, k%superFactor);
-	  }
-}
+            if (j > 0)
+                packed |= sub << ((j - 1) * 9);
+            if (k * blockWords + j < integers)
+                sub += __builtin_popcountl(data[k * blockWords + j]);
+        }
+        counts[2 * k] = total;
+        counts[2 * k + 1] = packed;
+        total += sub;
+    }
+    counts[2 * blocks] = total;
+    counts[2 * blocks + 1] = 0;
+    ones = total;
 
-ulong BitRank::BuildRankSub(ulong ini, ulong bloques){
-    ulong rank=0,aux;
-    
-	
-	for(ulong i=ini;i<ini+bloques;i++) {
-		if (i < integers) {
-			aux=data[i];
-			rank+=popcount(aux);
-		}
-	}
-     return rank; //return the numbers of 1's in the interval
+    // samples[i] is the block holding the (i * selectSample + 1):th 1; the
+    // entries past the last 1 point to the last block.
+    ulong numSamples = ones / selectSample + 2;
+    samples = new ulong[numSamples];
+    ulong i = 0;
+    for (ulong k = 0; k < blocks; k++)
+        while (i < numSamples && i * selectSample + 1 <= counts[2 * (k + 1)])
+            samples[i++] = k;
+    while (i < numSamples)
+        samples[i++] = blocks - 1;
 }
 
+inline ulong BitRank::Word(ulong k) {
+    if (rp == 0)
+        return data[k];
+    return rp->returnWord(data, k << wordShift, n);
+}
 
 //this rank ask from 0 to n-1
+BITRANK_CLONES
 ulong BitRank::rank(ulong i) {
     ++i; // the following gives sum of 1s before i 
-    if (rp == 0) return Rs[i>>8]+Rb[i>>wordShift]
-        +popcount(data[i >> wordShift] & ((1lu << (i & Wminusone))-1));
-
-    ulong result = rp->returnWord(data, (i >> wordShift) << wordShift, n);
-    result = Rs[i>>8]+Rb[i>>wordShift]
-        +popcount(result & ((1lu << (i & Wminusone))-1));
-    return result;
+    ulong k = i >> wordShift;
+    ulong block = k / blockWords;
+    return counts[2 * block] + subCount(counts[2 * block + 1], k % blockWords)
+        + __builtin_popcountl(Word(k) & ((1lu << (i & Wminusone))-1));
 }
 
+BITRANK_CLONES
 ulong BitRank::select(ulong x) {
     // returns i such that x=rank(i) && rank(i-1)<x or n if that i not exist
-    // first binary search over first level rank structure
-    // then sequential search using popcount over a int
-    // then sequential search using popcount over a char
-    // then sequential search bit a bit
-    
-    //binary search over first level rank structure
     if (x == 0)
         return 0;
-        
-    ulong l=0, r=n/s;
-    ulong mid=(l+r)/2;      
-    ulong rankmid = Rs[mid];
-    while (l<=r) {
-        if (rankmid<x)
-            l = mid+1;
-        else
-            r = mid-1;
-        mid = (l+r)/2;              
-        rankmid = Rs[mid];
-    }    
-    //sequential search using popcount over a int
-    ulong left;
-    left=mid*superFactor;
-    x-=rankmid;
-    ulong j;
-    if (rp == 0)
-        j = data[left];
-    else
-        j = rp->returnWord(data, left << wordShift, n);
-    
-    unsigned ones = popcount(j);
-    while (ones < x) {
-        x-=ones;left++;
-        if (left > integers) 
-            return n;
-            
-        if (rp == 0)
-            j = data[left];
+    if (x > ones)
+        return n;
+
+    // Last block between the two samples around x with less than x 1s
+    ulong l = samples[(x - 1) / selectSample],
+          r = samples[(x - 1) / selectSample + 1];
+    while (l < r)
+    {
+        ulong mid = (l + r + 1) / 2;
+        if (counts[2 * mid] < x)
+            l = mid;
         else
-            j = rp->returnWord(data, left << wordShift, n);
-        
-        ones = popcount(j);
-    }
-    //sequential search using popcount over a char
-    left=left*b; 
-    rankmid = popcount8(j);
-    if (rankmid < x) {
-        j=j>>8;
-        x-=rankmid;
-        left+=8;
-        rankmid = popcount8(j);
-        if (rankmid < x) {
-            j=j>>8;
-            x-=rankmid;
-            left+=8;
-            rankmid = popcount8(j);
-            if (rankmid < x) {
-                j=j>>8;
-                x-=rankmid;
-                left+=8;
-            }
-        }
+            r = mid - 1;
     }
+    x -= counts[2 * l];
 
-    // then sequential search bit a bit
-    while (x>0) {
-        if  (j&1lu) x--;
-        j=j>>1;
-        left++;
-    }
-    return left-1;
+    ulong packed = counts[2 * l + 1];
+    ulong j = 1;
+    while (j < blockWords && subCount(packed, j) < x)
+        j++;
+    j--;
+    x -= subCount(packed, j);
+    ulong k = l * blockWords + j;
+    return (k << wordShift) + selectWord(Word(k), x);
 }
 
+BITRANK_CLONES
 ulong BitRank::select0(ulong x) {
     // returns i such that x=rank0(i) && rank0(i-1)<x or n if that i not exist
-    // first binary search over first level rank structure
-    // then sequential search using popcount over a int
-    // then sequential search using popcount over a char
-    // then sequential search bit a bit
-    
-    //binary search over first level rank structure
     if (x == 0)
         return 0;
-        
-    ulong l=0, r=n/s;
-    ulong mid=(l+r)/2;
-    ulong rankmid = mid * s - Rs[mid];
-    while (l<=r) {
-        if (rankmid<x)
-            l = mid+1;
-        else
-            r = mid-1;
-        mid = (l+r)/2;              
-        rankmid = mid * s - Rs[mid];
-    }    
-    
-    //sequential search using popcount over a int
-    ulong left;
-    left=mid*superFactor;
-    x-=rankmid;
-    ulong j;
-    if (rp == 0)
-        j = data[left];
-    else
-        j = rp->returnWord(data, left << wordShift, n);
-    
-    unsigned zeros = W - popcount(j);
-    while (zeros < x) {
-        x-=zeros;
-        left++;
-        if (left > integers) 
-            return n;
-            
-        if (rp == 0)
-            j = data[left];
+    if (x > n - ones)
+        return n;
+
+    const ulong blockBits = blockWords * W;
+    ulong l = 0, r = blocks - 1;
+    while (l < r)
+    {
+        ulong mid = (l + r + 1) / 2;
+        if (mid * blockBits - counts[2 * mid] < x)
+            l = mid;
         else
-            j = rp->returnWord(data, left << wordShift, n);
-        zeros = W - popcount(j);
-    }
-    
-    //sequential search using popcount over a char
-    left=left*b;
-    rankmid = 8 - popcount8(j);
-    if (rankmid < x) {
-        j=j>>8;
-        x-=rankmid;
-        left+=8;
-        rankmid = 8 - popcount8(j);
-        if (rankmid < x) {
-            j=j>>8;
-            x-=rankmid;
-            left+=8;
-            rankmid = 8 - popcount8(j);
-            if (rankmid < x) {
-                j=j>>8;
-                x-=rankmid;
-                left+=8;
-            }
-        }
+            r = mid - 1;
     }
+    x -= l * blockBits - counts[2 * l];
 
-    // then sequential search bit a bit
-    while (x>0) {
-        if  (!(j&1lu)) x--;
-        j=j>>1;
-        left++;
-    }
-    return left - 1;
+    ulong packed = counts[2 * l + 1];
+    ulong j = 1;
+    while (j < blockWords && j * W - subCount(packed, j) < x)
+        j++;
+    j--;
+    x -= j * W - subCount(packed, j);
+    ulong k = l * blockWords + j;
+    return (k << wordShift) + selectWord(~Word(k), x);
 }
 
 
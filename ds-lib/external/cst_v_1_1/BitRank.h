@@ -2,35 +2,49 @@
 #ifndef _BITSTREAM_H_
 #define _BITSTREAM_H_
 
+// Rank and select are compiled twice, with and without the popcnt
+// instruction, and the version the CPU supports is picked at load time.
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__linux__)
+#define BITRANK_DISPATCH
+#define BITRANK_CLONES __attribute__((target_clones("popcnt", "default")))
+#else
+#define BITRANK_CLONES
+#endif
+
+#if W != 64
+#error BitRank requires 64 bit words
+#endif
+
 class BitRank {
 private:
-    // Check word length
-#if W == 32
-    static const unsigned wordShift = 5;
-    static const unsigned superFactor = 8; // 256 bit blocks
-#else
     static const unsigned wordShift = 6;
-    static const unsigned superFactor = 4; // 256 bit blocks
-#endif
+    static const ulong blockWords = 8; // 512 bit blocks
+    static const ulong selectSample = 512; // 1s between select samples
     
     ulong *data; //here is the bit-array
     bool owner;
     ulong n,integers;
-    unsigned b,s; 
-    ulong *Rs; //superblock array
-    uchar *Rb; //block array
+    ulong blocks, ones;
+    ulong *counts; // two words per block, see BitRank.cpp
+    ulong *samples; // block of every selectSample:th 1
     ReplacePattern *rp;
-    ulong BuildRankSub(ulong,  ulong); //internal use of BuildRank
     void BuildRank(); //crea indice para rank
+    ulong Word(ulong);
 public:
     BitRank(ulong *, ulong, bool, ReplacePattern * = 0);
+    BitRank(std::istream &, ulong *, ulong *, bool, ReplacePattern * = 0);
     ~BitRank(); //destructor    
     ulong rank(ulong i); //Rank from 0 to n-1
     ulong select(ulong x); // gives the position of the x:th 1.
     ulong select0(ulong x); // gives the position of the x:th 0.
 
     bool IsBitSet(ulong i);
+    inline void Prefetch(ulong i) {
+        __builtin_prefetch(data + i/W);
+        __builtin_prefetch(counts + 2 * (((i+1)>>wordShift) / blockWords));
+    }
     ulong NumberOfBits();
+    ulong Save(std::ostream &, bool);
 };
 
 #endif
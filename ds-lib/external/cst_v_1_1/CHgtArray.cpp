@@ -80,6 +80,23 @@ CHgtArray::CHgtArray(CSA *csa, const char *filename)
     this->Hgt = new BitRank(HgtBits, 2 * n, true);
 }
 
+// Construct from a stream written by Save()
+CHgtArray::CHgtArray(CSA *csa, std::istream &in, ulong *bytes)
+{
+    this->csa = csa;
+    *bytes += Tools::Read(in, &n, 1);
+    HgtBits = new ulong[2 * n / W + 1];
+    *bytes += Tools::Read(in, HgtBits, 2 * n / W + 1);
+    this->Hgt = new BitRank(in, bytes, HgtBits, true);
+}
+
+ulong CHgtArray::Save(std::ostream &out)
+{
+    ulong bytes = Tools::Write(out, &n, 1);
+    bytes += Tools::Write(out, HgtBits, 2 * n / W + 1);
+    bytes += Hgt->Save(out, false);
+    return bytes;
+}
 
 void CHgtArray::SaveToFile(const char *filename)
 {
@@ -36,9 +36,11 @@ private:
 public:
     CHgtArray(CSA *, const uchar *, ulong);
     CHgtArray(CSA *, const char *);
+    CHgtArray(CSA *, std::istream &, ulong *);
     ~CHgtArray();
     void SetSA(CSA *);
     void SaveToFile(const char *);
+    ulong Save(std::ostream &);
     ulong GetPos(ulong) const;
 };
 
@@ -161,6 +161,37 @@ CRMQ::CRMQ(BitRank *br, ulong *P, ulong n, unsigned sampleRate, unsigned subSamp
 }
 
 
+// Load the arrays written by Save(); br and P are shared as above.
+CRMQ::CRMQ(std::istream &in, ulong *bytes, BitRank *br, ulong *P)
+{
+    this->br = br;
+    this->P = P;
+    *bytes += Tools::Read(in, &n, 1);
+    *bytes += Tools::Read(in, &sampleRate, 1);
+    *bytes += Tools::Read(in, &subSampleRate, 1);
+    *bytes += Tools::Read(in, &blockSampleRate, 1);
+    widthM = Tools::CeilLog2(n / sampleRate + 1);
+    widthSubM = Tools::CeilLog2(sampleRate / subSampleRate + 1);
+    M = new ulong[(n / sampleRate + 1) * widthM];
+    *bytes += Tools::Read(in, M, (n / sampleRate + 1) * widthM);
+    subM = new ulong[((n / sampleRate + 1) * (sampleRate / subSampleRate) * widthSubM * widthSubM) / W + 1];
+    *bytes += Tools::Read(in, subM, ((n / sampleRate + 1) * (sampleRate / subSampleRate) * widthSubM * widthSubM) / W + 1);
+    srmq = new SubblockRMQ(in, bytes);
+}
+
+// Save everything except br and P. Returns the number of bytes written.
+ulong CRMQ::Save(std::ostream &out)
+{
+    ulong bytes = Tools::Write(out, &n, 1);
+    bytes += Tools::Write(out, &sampleRate, 1);
+    bytes += Tools::Write(out, &subSampleRate, 1);
+    bytes += Tools::Write(out, &blockSampleRate, 1);
+    bytes += Tools::Write(out, M, (n / sampleRate + 1) * widthM);
+    bytes += Tools::Write(out, subM, ((n / sampleRate + 1) * (sampleRate / subSampleRate) * widthSubM * widthSubM) / W + 1);
+    bytes += srmq->Save(out);
+    return bytes;
+}
+
 CRMQ::~CRMQ()
 {
     delete srmq;
@@ -99,8 +99,10 @@ private:
 
 public:
     CRMQ(BitRank *, ulong *, ulong, unsigned, unsigned, unsigned);
+    CRMQ(std::istream &, ulong *, BitRank *, ulong *);
     ~CRMQ();
     ulong lookup(ulong, ulong) const;
+    ulong Save(std::ostream &);
 };
 
 #endif
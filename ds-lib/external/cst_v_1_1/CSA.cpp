@@ -80,6 +80,34 @@ CSA::THuffAlphabetRank::THuffAlphabetRank(uchar *s, ulong n, TCodeEntry *codetab
 }
 
 
+// Load a subtree written by Save()
+CSA::THuffAlphabetRank::THuffAlphabetRank(std::istream &in, ulong *bytes, TCodeEntry *codetable) {
+    left = NULL;
+    right = NULL;
+    bitrank = NULL;
+    this->codetable = codetable;
+    *bytes += Tools::Read(in, &ch, 1);
+    *bytes += Tools::Read(in, &leaf, 1);
+    if (leaf)
+        return;
+    bitrank = new BitRank(in, bytes, 0, true);
+    left = new THuffAlphabetRank(in, bytes, codetable);
+    right = new THuffAlphabetRank(in, bytes, codetable);
+}
+
+// Save the subtree in preorder, returns the number of bytes written
+ulong CSA::THuffAlphabetRank::Save(std::ostream &out) {
+    ulong bytes = Tools::Write(out, &ch, 1);
+    bytes += Tools::Write(out, &leaf, 1);
+    if (leaf)
+        return bytes;
+    bytes += bitrank->Save(out, true);
+    bytes += left->Save(out);
+    bytes += right->Save(out);
+    return bytes;
+}
+
+
 bool CSA::THuffAlphabetRank::Test(uchar *s, ulong n) {
     // testing that the code works correctly
     int C[256];
@@ -150,19 +178,101 @@ CSA::CSA(uchar *text, ulong n, unsigned samplerate, const char *loadFromFile, co
     //    6*W/8+256*3*W/8+256*W/8+ (2*n/(samplerate*8))*W+sampled->SpaceRequirementInBits()/8+alphabetrank->SpaceRequirementInBits()/8+W/8);
 }
 
+// Load from a stream written by Save()
+CSA::CSA(std::istream &in, ulong *bytes) {
+    *bytes += Tools::Read(in, &n, 1);
+    *bytes += Tools::Read(in, &samplerate, 1);
+    *bytes += Tools::Read(in, C, 256);
+    *bytes += Tools::Read(in, &bwtEndPos, 1);
+    codetable = new TCodeEntry[256];
+    for (unsigned i = 0; i < 256; i++) {
+        *bytes += Tools::Read(in, &codetable[i].count, 1);
+        *bytes += Tools::Read(in, &codetable[i].bits, 1);
+        *bytes += Tools::Read(in, &codetable[i].code, 1);
+    }
+    alphabetrank = new THuffAlphabetRank(in, bytes, codetable);
+    sampled = new BitRank(in, bytes, 0, true);
+
+    ulong sampleLength = (n%samplerate==0) ? n/samplerate : n/samplerate+1;
+    suffixes = new ulong[sampleLength];
+    positions = new ulong[sampleLength];
+    *bytes += Tools::Read(in, suffixes, sampleLength);
+    *bytes += Tools::Read(in, positions, sampleLength);
+}
+
+// Returns the number of bytes written
+ulong CSA::Save(std::ostream &out) {
+    ulong bytes = Tools::Write(out, &n, 1);
+    bytes += Tools::Write(out, &samplerate, 1);
+    bytes += Tools::Write(out, C, 256);
+    bytes += Tools::Write(out, &bwtEndPos, 1);
+    for (unsigned i = 0; i < 256; i++) {
+        bytes += Tools::Write(out, &codetable[i].count, 1);
+        bytes += Tools::Write(out, &codetable[i].bits, 1);
+        bytes += Tools::Write(out, &codetable[i].code, 1);
+    }
+    bytes += alphabetrank->Save(out);
+    bytes += sampled->Save(out, true);
+
+    ulong sampleLength = (n%samplerate==0) ? n/samplerate : n/samplerate+1;
+    bytes += Tools::Write(out, suffixes, sampleLength);
+    bytes += Tools::Write(out, positions, sampleLength);
+    return bytes;
+}
+
 ulong CSA::lookup(ulong i) // Time complexity: O(samplerate log \sigma)
 {
     ulong dist=0;
     while (!sampled->IsBitSet(i)) 
     {
-        int c = alphabetrank->charAtPos(i);
-        i = C[c]+alphabetrank->rank(c,i)-1; // LF-mapping  
+        i = LF(i);
         ++dist;
     }
     
     return suffixes[sampled->rank(i)-1]+dist;
 }
 
+// Fills result[0..ep-sp] with lookup(sp..ep). The walks towards a sample
+// are run in lock-step over a window of entries, so that their memory
+// accesses overlap instead of each walk waiting on its own cache misses.
+void CSA::lookup(ulong sp, ulong ep, ulong *result)
+{
+    const ulong window = 256, ahead = 8;
+    ulong pos[window], idx[window];
+    for (ulong begin = sp; begin <= ep; begin += window)
+    {
+        ulong pending = std::min(window, ep - begin + 1);
+        for (ulong k = 0; k < pending; k++)
+        {
+            pos[k] = begin + k;
+            idx[k] = begin - sp + k;
+        }
+
+        for (ulong dist = 0; pending > 0; dist++)
+        {
+            ulong k = 0;
+            while (k < pending)
+            {
+                if (k + ahead < pending)
+                {
+                    sampled->Prefetch(pos[k + ahead]);
+                    alphabetrank->Prefetch(pos[k + ahead]);
+                }
+                ulong p = pos[k];
+                if (sampled->IsBitSet(p))
+                {
+                    result[idx[k]] = suffixes[sampled->rank(p)-1]+dist;
+                    pending--;
+                    pos[k] = pos[pending];
+                    idx[k] = idx[pending];
+                }
+                else
+                    pos[k++] = LF(p);
+            }
+        }
+    }
+}
+
 ulong CSA::Psi(ulong i)   // Time complexity: O(samplerate log \sigma)
 {
     // Return 0 if SA[i] = n
@@ -170,12 +280,10 @@ ulong CSA::Psi(ulong i)   // Time complexity: O(samplerate log \sigma)
         return 0;
 
     // Search sampled position so that SA[j] less than or equal to SA[i]    
-    int c;
     unsigned j = i;
     while (!sampled->IsBitSet(j)) 
     {
-        c = alphabetrank->charAtPos(j);
-        j = C[c]+alphabetrank->rank(c,j)-1; // LF-mapping  
+        j = LF(j);
     }
 
     // Move to j =  inverse SA[ SA[j] + samplerate ]
@@ -190,8 +298,7 @@ ulong CSA::Psi(ulong i)   // Time complexity: O(samplerate log \sigma)
     do
     {
         prev = j;
-        c = alphabetrank->charAtPos(j);
-        j = C[c]+alphabetrank->rank(c,j)-1; // LF-mapping  
+        j = LF(j);
     } while (j != i);
 
     // Return the previous j value prev
@@ -202,11 +309,18 @@ ulong CSA::Psi(ulong i)   // Time complexity: O(samplerate log \sigma)
 uchar * CSA::substring(ulong i, ulong l)
 {
     uchar *result = new uchar[l + 1];
-    if (l == 0)
-    {
-        result[0] = 0u;
-        return result;
-    }
+    l = substring(i, l, result);
+    result[l] = 0u;
+    return result;
+}
+
+// Writes T[i..i+l-1] to result without allocating or a terminating 0;
+// returns the number of characters written, which is less than l at the
+// end of the text.
+ulong CSA::substring(ulong i, ulong l, uchar *result)
+{
+    if (l == 0 || i >= n)
+        return 0;
       
     ulong dist;
     ulong k = i + l - 1;
@@ -232,13 +346,13 @@ uchar * CSA::substring(ulong i, ulong l)
     
     for (dist = 0; dist < skip + l; dist++) 
     {
-        int c = alphabetrank->charAtPos(j);
-        j = C[c]+alphabetrank->rank(c,j)-1; // LF-mapping
+        ulong r;
+        int c = alphabetrank->charAtPos(j, &r);
+        j = C[c]+r; // LF-mapping
         if (dist >= skip)
             result[l + skip - dist - 1] = c;
     }
-    result[l] = 0u;
-    return result;
+    return l;
 }
 
 ulong CSA::inverse(ulong i)
@@ -258,8 +372,7 @@ ulong CSA::inverse(ulong i)
     
     while (skip > 0)
     {
-        int c = alphabetrank->charAtPos(j);
-        j = C[c]+alphabetrank->rank(c,j)-1; // LF-mapping
+        j = LF(j);
         skip --;
     }
     return j;
@@ -270,7 +383,7 @@ ulong CSA::Search(uchar *pattern, ulong m, ulong *spResult, ulong *epResult) {
     int c = (int)pattern[m-1]; 
     int i=m-1;
     int sp = C[c];
-    int ep = C[c+1]-1;
+    int ep = (c == 255 ? n : C[c+1])-1;
     while (sp<=ep && i>=1) 
     {
         c = (int)pattern[--i];
@@ -322,8 +435,7 @@ void CSA::maketables()
         }
 
         //p= wt->LFmapping(p+1)-1;
-        uchar c = alphabetrank->charAtPos(p);
-        p = C[c]+alphabetrank->rank(c, p)-1;
+        p = LF(p);
     }
 
 //      printf("Sampled positions:\n0123456789012345678901234567890123456789\n");
@@ -5,6 +5,7 @@
 
 #ifndef _CSA_H_
 #define _CSA_H_
+#include <algorithm>
 #include <iostream>
 #include <queue>
 #include <iomanip>
@@ -33,7 +34,9 @@ private:
         bool leaf;
     public:
         THuffAlphabetRank(uchar *, ulong, TCodeEntry *, unsigned);
+        THuffAlphabetRank(std::istream &, ulong *, TCodeEntry *);
         ~THuffAlphabetRank();
+        ulong Save(std::ostream &);
         bool Test(uchar *, ulong);
         
         inline ulong rank(int c, ulong i) { // returns the number of characters c before and including position i
@@ -88,6 +91,27 @@ private:
             }
             return (int)temp->ch;
         }
+        // Same as charAtPos(i), but also sets *r to rank(c, i) - 1 for the
+        // returned character c, which falls out of the same walk.
+        inline int charAtPos(ulong i, ulong *r) {
+            THuffAlphabetRank *temp=this;
+            while (!temp->leaf) {
+                if (temp->bitrank->IsBitSet(i)) {
+                    i = temp->bitrank->rank(i)-1;
+                    temp = temp->right;
+                }
+                else {
+                    i = i-temp->bitrank->rank(i);
+                    temp = temp->left;
+                }
+            }
+            *r = i;
+            return (int)temp->ch;
+        }
+        inline void Prefetch(ulong i) {
+            if (!leaf)
+                bitrank->Prefetch(i);
+        }
     };
 
     class node {
@@ -140,15 +164,24 @@ private:
     uchar * LoadFromFile(const char *);
     void SaveToFile(const char *, uchar *);
     void maketables();
+    inline ulong LF(ulong i) {
+        ulong r;
+        int c = alphabetrank->charAtPos(i, &r);
+        return C[c]+r;
+    }
 
 public:
     CSA(uchar *, ulong, unsigned, const char * = 0, const char * = 0);
+    CSA(std::istream &, ulong *);
     ~CSA();
     ulong Search(uchar *, ulong, ulong *, ulong *);
     ulong lookup(ulong);
+    void lookup(ulong, ulong, ulong *);
     ulong inverse(ulong);
     ulong Psi(ulong);
     uchar * substring(ulong, ulong);
+    ulong substring(ulong, ulong, uchar *);
+    ulong Save(std::ostream &);
 };
 
 #endif
@@ -26,6 +26,28 @@ Hash::Hash(ulong n, unsigned vbits, double factor)
         table[i] = 0;
    }
 
+  // loads a table written by Save
+
+Hash::Hash (std::istream &in, ulong *bytes)
+
+   {
+     *bytes += Tools::Read(in, &size, 1);
+     *bytes += Tools::Read(in, &bits, 1);
+     table = new ulong[((size+1)*bits+W-1)/W];
+     *bytes += Tools::Read(in, table, ((size+1)*bits+W-1)/W);
+   }
+
+  // writes the table, returns the number of bytes written
+
+ulong Hash::Save (std::ostream &out)
+
+   {
+     ulong bytes = Tools::Write(out, &size, 1);
+     bytes += Tools::Write(out, &bits, 1);
+     bytes += Tools::Write(out, table, ((size+1)*bits+W-1)/W);
+     return bytes;
+   }
+
   // frees the structure
 
 Hash::~Hash ()
@@ -46,10 +46,12 @@ private:
 
 public:
     Hash (ulong n, unsigned vbits, double factor);
+    Hash (std::istream &, ulong *);
     ~Hash();
     void insertHash(ulong, ulong);
     unsigned searchHash (ulong key, ulong *h);
     unsigned nextHash (ulong *h);
+    ulong Save (std::ostream &);
 };
 
 #endif
@@ -22,6 +22,7 @@
  ***************************************************************************/
  
 #include "Parentheses.h"
+#include <mutex>
 
   // I have decided not to implement Munro et al.'s scheme, as it is too
   // complicated and the overhead is not so small in practice. I have opted 
@@ -67,11 +68,13 @@
    static unsigned char FwdPos[256][W/2];
    static unsigned char BwdPos[256][W/2];
    static char Excess[256];
-   static bool tablesComputed = false;
+   // Shared by all instances; filled once, even when trees are built or
+   // loaded from several threads at a time
+   static std::once_flag tablesComputed;
 
 Parentheses::Parentheses (ulong *string, ulong n, bool bwd, BitRank *br)
 { 
-     ulong i,s,nb,ns,nbits;
+     ulong s,nb,ns,nbits;
      this->bp = string;
      this->n = n;
      this->br = br;
@@ -93,15 +96,63 @@ Parentheses::Parentheses (ulong *string, ulong n, bool bwd, BitRank *br)
     }
      else sbtable = bbtable = 0;
      filltables (bwd);
-     if (!tablesComputed)
-    { tablesComputed = true;
-      for (i=0;i<256;i++) 
+     computetables();
+   }
+
+    // loads the structure written by Save, bp and br are shared as above
+
+Parentheses::Parentheses (std::istream &in, ulong *bytes, ulong *string, BitRank *br)
+{
+     this->bp = string;
+     this->br = br;
+     *bytes += Tools::Read(in, &n, 1);
+     *bytes += Tools::Read(in, &sbits, 1);
+     *bytes += Tools::Read(in, &near, 1);
+     *bytes += Tools::Read(in, &far, 1);
+     *bytes += Tools::Read(in, &pnear, 1);
+     *bytes += Tools::Read(in, &pfar, 1);
+     sftable = new Hash (in, bytes);
+     bftable = new Hash (in, bytes);
+     bool bwd;
+     *bytes += Tools::Read(in, &bwd, 1);
+     if (bwd)
+    { sbtable = new Hash (in, bytes);
+      bbtable = new Hash (in, bytes);
+    }
+     else sbtable = bbtable = 0;
+     computetables();
+}
+
+    // writes the structure except bp and br, returns the number of bytes
+
+ulong Parentheses::Save (std::ostream &out)
+{
+     ulong bytes = Tools::Write(out, &n, 1);
+     bytes += Tools::Write(out, &sbits, 1);
+     bytes += Tools::Write(out, &near, 1);
+     bytes += Tools::Write(out, &far, 1);
+     bytes += Tools::Write(out, &pnear, 1);
+     bytes += Tools::Write(out, &pfar, 1);
+     bytes += sftable->Save(out);
+     bytes += bftable->Save(out);
+     bool bwd = sbtable != 0;
+     bytes += Tools::Write(out, &bwd, 1);
+     if (bwd)
+    { bytes += sbtable->Save(out);
+      bytes += bbtable->Save(out);
+    }
+     return bytes;
+}
+
+void Parentheses::computetables()
+{
+     std::call_once(tablesComputed, [this]()
+    { for (ulong i=0;i<256;i++) 
           { fcompchar (i,FwdPos[i],Excess+i); //printf("i = %d\t, FwdPos[i] = %c\t, Excess+i = %c\n", i,FwdPos[i],Excess+i);
             bcompchar (i,BwdPos[i]);//printf("i = %d\t, BwdPos[i] = %c\t, Excess+i = %c\n", i,BwdPos[i],Excess+i);
           }
-    }
-     
-   }
+    });
+}
 
     // frees parentheses structure, including the bitstream
 
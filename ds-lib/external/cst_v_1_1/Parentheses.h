@@ -58,8 +58,10 @@ private:
     void filltables (bool);
     void fcompchar (unsigned char, unsigned char*, char*);
     void bcompchar (unsigned char, unsigned char* );
+    void computetables();
 public:
     Parentheses(ulong* bp, ulong n, bool bwd, BitRank *);
+    Parentheses(std::istream &, ulong *, ulong* bp, BitRank *);
     ~Parentheses();
     ulong findopen(ulong);
     ulong findclose(ulong);
@@ -67,5 +69,6 @@ public:
     ulong enclose(ulong);
     ulong findparent(ulong);
     ulong isOpen(ulong);
+    ulong Save(std::ostream &);
 };
 #endif
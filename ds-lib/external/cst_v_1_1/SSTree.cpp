@@ -213,6 +213,59 @@ SSTree::SSTree(uchar *text, ulong n, bool deletetext, unsigned samplerate, io_ac
     #endif
 }
 
+/**
+ * Constructor from a stream written by Save().
+ *
+ * Every component is read back as is; only the replace pattern tables,
+ * which depend on nothing but their parameters, are recomputed.
+ *
+ * @param in stream positioned at the start of the tree.
+ * @param bytes incremented by the number of bytes read.
+ */
+SSTree::SSTree(std::istream &in, ulong *bytes)
+{
+    *bytes += Tools::Read(in, &n, 1);
+    sa = new CSA(in, bytes);
+    hgt = new CHgtArray(sa, in, bytes);
+
+    ulong bitsInP;
+    *bytes += Tools::Read(in, &bitsInP, 1);
+    P = new ulong[bitsInP / W + 1];
+    *bytes += Tools::Read(in, P, bitsInP / W + 1);
+
+    br = new BitRank(in, bytes, P, false);
+    Pr = new Parentheses(in, bytes, P, br);
+    rpLeaf = new ReplacePattern(1, 8);
+    rpSibling = new ReplacePattern(0, 8);
+    brLeaf = new BitRank(in, bytes, P, false, rpLeaf);
+    brSibling = new BitRank(in, bytes, P, false, rpSibling);
+    rmq = new CRMQ(in, bytes, br, P);
+}
+
+/**
+ * Writes all components of the tree to a stream.
+ *
+ * @param out the output stream.
+ * @return number of bytes written.
+ */
+ulong SSTree::Save(std::ostream &out)
+{
+    ulong bytes = Tools::Write(out, &n, 1);
+    bytes += sa->Save(out);
+    bytes += hgt->Save(out);
+
+    ulong bitsInP = br->NumberOfBits();
+    bytes += Tools::Write(out, &bitsInP, 1);
+    bytes += Tools::Write(out, P, bitsInP / W + 1);
+
+    bytes += br->Save(out, false);
+    bytes += Pr->Save(out);
+    bytes += brLeaf->Save(out, false);
+    bytes += brSibling->Save(out, false);
+    bytes += rmq->Save(out);
+    return bytes;
+}
+
 /**
  * A destructor. 
  */
@@ -306,7 +359,7 @@ ulong SSTree::parent(ulong v)
  */
 uchar SSTree::edge(ulong v, ulong d) 
 {
-    uchar *ss; 
+    uchar result = 0u;
     if (isleaf(v))
     {
         ulong i = leftrank(v);
@@ -314,9 +367,7 @@ uchar SSTree::edge(ulong v, ulong d)
         ulong d1 = sa->lookup(i) + j;
         if (d > n - d1)
             return 0u;
-        ss = sa->substring(d1 + d - 1,1);
-        uchar result = ss[0];
-        delete [] ss;
+        sa->substring(d1 + d - 1, 1, &result);
         return result;
     }
     
@@ -324,9 +375,7 @@ uchar SSTree::edge(ulong v, ulong d)
     ulong d2 = hgt->GetPos(inorder(v));
     if (d > d2 - d1)
         return 0u;
-    ss = sa->substring(sa->lookup(inorder(v)) + d1 + d - 1,1);
-    uchar result = ss[0];
-    delete [] ss;
+    sa->substring(sa->lookup(inorder(v)) + d1 + d - 1, 1, &result);
     return result;    
 }
 
@@ -377,6 +426,11 @@ uchar *SSTree::substring(ulong i, ulong k)
    return sa->substring(i,k);
 }
 
+ulong SSTree::substring(ulong i, ulong k, uchar *result)
+{
+   return sa->substring(i,k,result);
+}
+
 /**
  * Returns the string depth of the node v.
  */
@@ -93,7 +93,9 @@ public:
     CSA *sa;
 
     SSTree(uchar *, ulong, bool = false, unsigned = 0, io_action = nop, const char * = 0);
+    SSTree(std::istream &, ulong *);
     ~SSTree();
+    ulong Save(std::ostream &);
     ulong root();
     bool isleaf(ulong) ;
     ulong child(ulong, uchar);
@@ -104,6 +106,7 @@ public:
     uchar* edge(ulong) ;
     uchar* pathlabel(ulong);
     uchar* substring(ulong, ulong);
+    ulong substring(ulong, ulong, uchar *);
     ulong depth(ulong);
     ulong nodeDepth(ulong);
     ulong lca(ulong, ulong);
@@ -67,6 +67,23 @@ SubblockRMQ::SubblockRMQ(unsigned sampleRate)
     }
 }
 
+// Load the table written by Save()
+SubblockRMQ::SubblockRMQ(std::istream &in, ulong *bytes)
+{
+    *bytes += Tools::Read(in, &sampleRate, 1);
+    answerWidth = Tools::CeilLog2(sampleRate);
+    answer = new ulong[((1 << sampleRate) * sampleRate * sampleRate * answerWidth) /  W + 1];
+    *bytes += Tools::Read(in, answer, ((1 << sampleRate) * sampleRate * sampleRate * answerWidth) /  W + 1);
+}
+
+// Returns the number of bytes written
+ulong SubblockRMQ::Save(std::ostream &out)
+{
+    ulong bytes = Tools::Write(out, &sampleRate, 1);
+    bytes += Tools::Write(out, answer, ((1 << sampleRate) * sampleRate * sampleRate * answerWidth) /  W + 1);
+    return bytes;
+}
+
 SubblockRMQ::~SubblockRMQ()
 {
     delete [] answer;
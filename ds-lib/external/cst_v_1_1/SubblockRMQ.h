@@ -37,8 +37,10 @@ private:
 
 public:
     SubblockRMQ(unsigned);
+    SubblockRMQ(std::istream &, ulong *);
     ~SubblockRMQ();
     unsigned lookup(unsigned, unsigned, unsigned) const;
+    ulong Save(std::ostream &);
 };
 
 #endif
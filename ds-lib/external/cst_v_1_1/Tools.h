@@ -111,7 +111,21 @@ public:
         } 
     }
 
+    // Raw (de)serialization of n elements of an array; both return the
+    // number of bytes transferred.
+    template <typename T>
+    static inline ulong Write(std::ostream &out, const T *A, ulong n)
+    {
+        out.write((const char *)A, n * sizeof(T));
+        return n * sizeof(T);
+    }
 
+    template <typename T>
+    static inline ulong Read(std::istream &in, T *A, ulong n)
+    {
+        in.read((char *)A, n * sizeof(T));
+        return n * sizeof(T);
+    }
 };
 
 #endif
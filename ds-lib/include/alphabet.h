@@ -0,0 +1,56 @@
+#ifndef DSL_ALPHABET_H_
+#define DSL_ALPHABET_H_
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace dsl {
+
+// The set of byte values that occur in a text, mapped to dense codes
+// 0..size()-1 in increasing (unsigned) byte order, so that comparing codes
+// orders strings the same way as comparing the raw bytes.
+class Alphabet {
+ public:
+  Alphabet();
+  Alphabet(const char* input, size_t size);
+
+  bool contains(char c) const {
+    return present_[(uint8_t) c];
+  }
+
+  // Returns false as soon as str has a symbol that never occurs in the text;
+  // no such string can match.
+  bool containsAll(const std::string& str) const;
+
+  // Only defined for symbols that occur in the text.
+  uint8_t encode(char c) const {
+    return codes_[(uint8_t) c];
+  }
+
+  char decode(uint8_t code) const {
+    return symbols_[code];
+  }
+
+  uint32_t size() const;
+
+  // Number of bits needed to store any code.
+  uint32_t bitsPerSymbol() const;
+
+  // The symbols in code order.
+  const std::string& symbols() const;
+
+  size_t serialize(std::ostream& out);
+  size_t deserialize(std::istream& in);
+
+ private:
+  void buildCodes();
+
+  std::string symbols_;
+  bool present_[256];
+  uint8_t codes_[256];
+};
+
+}
+
+#endif // DSL_ALPHABET_H_
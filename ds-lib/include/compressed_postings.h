@@ -0,0 +1,69 @@
+#ifndef DSL_COMPRESSED_POSTINGS_H_
+#define DSL_COMPRESSED_POSTINGS_H_
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace dsl {
+
+// Increasing lists of offsets, delta encoded. Every full block of kBlockSize
+// values is bit packed at the width of its largest delta, in four
+// interleaved 32-bit lanes so that SSE2 unpacks four values per instruction;
+// the first value and position of every block are kept in a skip table. The
+// values past a list's last full block are variable-byte encoded.
+class CompressedPostings {
+ public:
+  static const uint64_t kBlockSize = 128;
+
+  CompressedPostings();
+  // Encodes list i as values[offsets[i]..offsets[i + 1]).
+  CompressedPostings(const uint64_t* values,
+                     const std::vector<uint64_t>& offsets);
+
+  uint64_t numLists() const;
+  // Number of values in the lists before list.
+  uint64_t offset(uint64_t list) const;
+  uint64_t size(uint64_t list) const;
+
+  // Writes the size(list) values of list to out.
+  void decode(uint64_t list, uint64_t* out) const;
+
+  // Keeps the values v, which must be increasing, for which v + shift is in
+  // list. Gallops over the skip table and within decoded blocks, so a short
+  // values list only decodes the blocks it lands in.
+  void intersect(uint64_t list, uint64_t shift,
+                 std::vector<uint64_t>& values) const;
+
+  size_t serialize(std::ostream& out);
+  size_t deserialize(std::istream& in);
+
+ private:
+  // Marks a block whose values span more than 32 bits, which is stored as
+  // plain 64-bit values.
+  static const uint8_t kRawBlock = 64;
+
+  void encodeBlock(const uint64_t* values);
+  // Writes the kBlockSize values of block to out.
+  void decodeBlock(uint64_t block, uint64_t* out) const;
+  // Writes the values of list past its last full block to out, where prev
+  // is the last value of that block, and returns their number.
+  uint64_t decodeTail(uint64_t list, uint64_t prev, uint64_t* out) const;
+
+  // Per list: the index of its first value and of its first block, and the
+  // position of its variable-byte tail in data_.
+  std::vector<uint64_t> offsets_;
+  std::vector<uint64_t> blocks_;
+  std::vector<uint64_t> tails_;
+
+  // Per block: its first value and its position in data_, where a width
+  // byte precedes the packed deltas.
+  std::vector<uint64_t> block_first_;
+  std::vector<uint64_t> block_data_;
+
+  std::vector<uint8_t> data_;
+};
+
+}
+
+#endif // DSL_COMPRESSED_POSTINGS_H_
@@ -0,0 +1,58 @@
+#ifndef DSL_COMPRESSED_TEXT_STORE_H_
+#define DSL_COMPRESSED_TEXT_STORE_H_
+
+#include <vector>
+
+#include "bitmap_array.h"
+#include "text_store.h"
+
+namespace dsl {
+
+// Huffman-coded text. Code lengths are limited to kMaxCodeLength bits so that
+// every symbol decodes with a single table lookup. The bit offset of every
+// kBlockSize-th symbol is sampled, so a random access decodes at most one
+// block; recently decoded blocks are kept in a small per-thread cache.
+class CompressedTextStore : public TextStore {
+ public:
+  static const uint32_t kMaxCodeLength = 12;
+  static const uint32_t kBlockSize = 256;
+  static const uint32_t kCacheEntries = 8;
+
+  CompressedTextStore();
+  CompressedTextStore(const char* input, size_t size);
+  ~CompressedTextStore();
+
+  StoreType type() const;
+
+  size_t serialize(std::ostream& out);
+  size_t deserialize(std::istream& in);
+
+ protected:
+  char decodeAt(uint64_t i) const;
+  void decode(char* buf, uint64_t pos, uint64_t len) const;
+
+ private:
+  void computeCodeLengths(const uint64_t* freqs);
+  void buildCodes();
+  void encode(const char* input);
+  // Decodes the first n symbols of the block into buf.
+  void decodeBlock(uint64_t block, char* buf, uint64_t n) const;
+  uint64_t blockLength(uint64_t block) const;
+  const char* cachedBlock(uint64_t block) const;
+
+  uint8_t code_lengths_[256];
+  uint32_t codes_[256];
+  // Indexed by the next kMaxCodeLength bits of the stream; holds the decoded
+  // symbol in the low byte and its code length in the high byte.
+  uint16_t decode_table_[1 << kMaxCodeLength];
+
+  std::vector<uint64_t> bits_;
+  BitmapArray *block_offsets_;
+
+  // Distinguishes stores in the per-thread decode cache.
+  uint64_t id_;
+};
+
+}
+
+#endif // DSL_COMPRESSED_TEXT_STORE_H_
@@ -0,0 +1,51 @@
+#ifndef DSL_PIECEWISE_LINEAR_MODEL_H_
+#define DSL_PIECEWISE_LINEAR_MODEL_H_
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace dsl {
+
+// Maps sorted keys to positions with a sequence of linear segments, each of
+// which predicts the position of every key it was built from to within
+// +/- error. Segments are fit greedily in a single pass (shrinking cone), so
+// keys must be added in strictly increasing order.
+class PiecewiseLinearModel {
+ public:
+  PiecewiseLinearModel(uint64_t error = 64);
+
+  void add(uint64_t key, uint64_t pos);
+  void finish();
+
+  // Predicted position of key; exact to within error() for keys that were
+  // added, and monotone in key otherwise.
+  int64_t predict(uint64_t key) const;
+
+  uint64_t error() const;
+  size_t numSegments() const;
+
+  size_t serialize(std::ostream& out);
+  size_t deserialize(std::istream& in);
+
+ private:
+  void closeSegment();
+
+  uint64_t error_;
+
+  // Segment i covers keys in [keys_[i], keys_[i + 1]).
+  std::vector<uint64_t> keys_;
+  std::vector<uint64_t> positions_;
+  std::vector<double> slopes_;
+
+  // State of the segment currently being fit.
+  bool open_;
+  uint64_t first_key_;
+  uint64_t first_pos_;
+  double slope_lo_;
+  double slope_hi_;
+};
+
+}
+
+#endif // DSL_PIECEWISE_LINEAR_MODEL_H_
@@ -0,0 +1,63 @@
+#ifndef DSL_PREFIX_TRIE_H_
+#define DSL_PREFIX_TRIE_H_
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "suffix_array.h"
+#include "text_store.h"
+
+namespace dsl {
+
+// Trie over the first few characters of every suffix, where each node holds
+// the range of the suffix array whose suffixes start with its path label.
+// It answers queries no deeper than the trie without touching the suffix
+// array or the text, and narrows down the search for longer ones. Levels are
+// only ever included whole, so a missing child means no occurrence. Paths
+// stop at '\0'.
+class PrefixTrie {
+ public:
+  static const uint64_t kDefaultMaxNodes = 1 << 20;
+
+  PrefixTrie();
+  // Includes every level up to max_depth that keeps the trie within
+  // max_nodes nodes.
+  PrefixTrie(const TextStore* text, SuffixArray* sa, uint64_t size,
+             uint32_t max_depth, uint64_t max_nodes = kDefaultMaxNodes);
+
+  // Finds the deepest node on query's path; the suffixes starting with the
+  // first *depth characters of query are sa[*lb..*rb). Returns false if no
+  // suffix starts with query.
+  bool find(const std::string& query, uint64_t* lb, uint64_t* rb,
+            uint32_t* depth) const;
+
+  uint32_t depth() const;
+  uint64_t numNodes() const;
+
+  size_t serialize(std::ostream& out);
+  size_t deserialize(std::istream& in);
+
+ private:
+  // Calls visit(i, lcp, len, prefix) for every suffix in suffix array order,
+  // where lcp is the length of the prefix shared with the previous suffix and
+  // len the number of characters before any '\0', both capped at depth.
+  template<typename Visitor>
+  static void scanSuffixes(const TextStore* text, SuffixArray* sa,
+                           uint64_t size, uint32_t depth, Visitor visit);
+
+  uint32_t depth_;
+
+  // Nodes are numbered level by level, in suffix array order within a level,
+  // so the children of node i are [child_begin_[i], child_begin_[i + 1]),
+  // sorted by label. Node 0 is the root.
+  std::vector<uint32_t> child_begin_;
+  std::vector<uint8_t> label_;
+  std::vector<uint64_t> lb_;
+  std::vector<uint64_t> rb_;
+};
+
+}
+
+#endif // DSL_PREFIX_TRIE_H_
@@ -0,0 +1,36 @@
+#ifndef DSL_SUBSTRING_SEARCH_H_
+#define DSL_SUBSTRING_SEARCH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dsl {
+
+// Substring search kernels over raw text. Candidate positions are filtered on
+// the first and last byte of the pattern 32 (AVX2) or 16 (SSE2) positions at
+// a time, and only the surviving candidates are verified with memcmp. The
+// widest kernel supported by the CPU is picked at runtime.
+//
+// All functions only consider occurrences starting in [begin, end) of the
+// text text[0..size); matches may extend past end.
+class SubstringSearch {
+ public:
+  // Appends the matching positions to results in increasing order, stopping
+  // after limit matches (0 means no limit).
+  static void findAll(std::vector<int64_t>& results, const char* text,
+                      uint64_t size, uint64_t begin, uint64_t end,
+                      const char* pattern, size_t len, size_t limit = 0);
+
+  // Returns the number of matching positions.
+  static uint64_t count(const char* text, uint64_t size, uint64_t begin,
+                        uint64_t end, const char* pattern, size_t len);
+
+  // Returns the first matching position, or -1 if there is none.
+  static int64_t findFirst(const char* text, uint64_t size, uint64_t begin,
+                           uint64_t end, const char* pattern, size_t len);
+};
+
+}
+
+#endif // DSL_SUBSTRING_SEARCH_H_
@@ -1,6 +1,7 @@
 #ifndef DSL_SUFFIX_ARRAY_H_
 #define DSL_SUFFIX_ARRAY_H_
 
+#include "alphabet.h"
 #include "bitmap_array.h"
 
 namespace dsl {
@@ -10,6 +11,8 @@ class SuffixArray : public BitmapArray {
   SuffixArray();
   SuffixArray(const std::string& input);
   SuffixArray(const char* input, size_t size);
+  // Sorts over the alphabet's dense codes rather than all 256 byte values.
+  SuffixArray(const char* input, size_t size, const Alphabet& alphabet);
   SuffixArray(uint64_t* suffix_array, size_t size);
 };
 
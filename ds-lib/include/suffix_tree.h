@@ -1,225 +1,152 @@
 #ifndef DSL_SUFFIX_TREE_H_
 #define DSL_SUFFIX_TREE_H_
 
-#include <cassert>
 #include <vector>
 
 #include "bitmap_array.h"
+#include "text_store.h"
 
 namespace dsl {
 
 namespace st {
 
-struct Node {
-  Node(bool is_leaf) {
-    is_leaf_ = is_leaf;
-    parent_ = NULL;
-  }
-  Node* parent_;
-  bool is_leaf_;
-};
+// Nodes of a CompactSuffixTree are referred to by index. Leaves have the top
+// bit set and are numbered separately from internal nodes.
+typedef uint64_t NodeId;
+const NodeId kLeafFlag = 1ULL << 63;
+const NodeId kNoNode = ~0ULL;
 
-struct InternalNode : public Node {
-  InternalNode()
-      : Node(false) {
-  }
+}
 
-  uint32_t edgeLength(uint32_t child_id) {
-    return end_.at(child_id) - start_.at(child_id) + 1;
+// Suffix tree stored as flat arrays, built bottom-up from the suffix and LCP
+// arrays without allocating individual nodes. The end of the text acts as a
+// terminator that sorts before every byte, so the text may contain any byte.
+class CompactSuffixTree {
+ public:
+  virtual ~CompactSuffixTree() {
   }
 
-  uint32_t leftmostChildId() {
-    return children_.size() - 1;
-  }
+  // Builds a tree with offsets just wide enough for size, on num_threads
+  // threads; 0 uses all hardware threads.
+  static CompactSuffixTree* create(const char* input, uint64_t size,
+                                   uint32_t num_threads = 1);
 
-  uint32_t addChild(uint32_t start, uint32_t end, st::Node *child) {
-    assert(end >= start);
+  // Highest node whose path label has query as a prefix, or kNoNode.
+  virtual st::NodeId walkTree(const std::string& query) const = 0;
+  // Both take time independent of the size of the subtree below node, apart
+  // from copying out the offsets.
+  virtual void getOffsets(std::vector<int64_t>& results,
+                          st::NodeId node) const = 0;
+  virtual int64_t countLeaves(st::NodeId node) const = 0;
 
-    start_.push_back(start);
-    end_.push_back(end);
-    children_.push_back(child);
-    child->parent_ = this;
-    return children_.size() - 1;
-  }
+  // lengths[i] becomes the length of the longest prefix of pattern[i..] that
+  // occurs in the text. Follows suffix links, so takes time linear in the
+  // length of the pattern.
+  virtual void matchingStatistics(std::vector<int64_t>& lengths,
+                                  const std::string& pattern) const = 0;
 
-  void removeChild(uint32_t child_id) {
-    assert(child_id < children_.size());
+  virtual char charAt(uint64_t i) const = 0;
 
-    start_.erase(start_.begin() + child_id);
-    end_.erase(end_.begin() + child_id);
-    children_.erase(children_.begin() + child_id);
-  }
+  // Swaps the plain copy of the text for a compressed one.
+  virtual void compressText() = 0;
 
-  std::vector<uint32_t> start_;
-  std::vector<uint32_t> end_;
-  std::vector<Node *> children_;
-};
+  virtual size_t serialize(std::ostream& out) = 0;
+  virtual size_t deserialize(std::istream& in) = 0;
 
-struct LeafNode : public Node {
-  LeafNode(uint32_t offset)
-      : Node(true) {
-    offset_ = offset;
-  }
-  uint32_t offset_;
-};
+  // Writes tree preceded by its offset width, so that readTree can recreate
+  // it.
+  static size_t writeTree(std::ostream& out, CompactSuffixTree* tree);
+  static CompactSuffixTree* readTree(std::istream& in, size_t* in_size);
 
-struct CompactNode {
-  CompactNode(bool is_leaf) {
-    is_leaf_ = is_leaf;
-  }
-  virtual ~CompactNode() {
-  }
-
-  virtual size_t size() = 0;
-  bool is_leaf_;
+ protected:
+  virtual uint8_t offsetWidth() const = 0;
 };
 
-struct CompactLeafNode : CompactNode {
-  CompactLeafNode(uint32_t offset)
-      : CompactNode(true) {
-    offset_ = offset;
-  }
-
-  CompactLeafNode(LeafNode *node)
-      : CompactNode(true) {
-    offset_ = node->offset_;
-  }
-
-  size_t size() {
-    return sizeof(uint32_t) + sizeof(uint8_t);
-  }
-
-  uint32_t offset_;
-};
-
-struct CompactInternalNode : CompactNode {
-  CompactInternalNode()
-      : CompactNode(false) {
-    size_ = 0;
-    start_ = NULL;
-    end_ = NULL;
-    children_ = NULL;
-  }
-
-  CompactInternalNode(InternalNode *node)
-      : CompactNode(false) {
-    assert(node->children_.size() < 256);
-
-    size_ = node->children_.size();
-    start_ = new uint32_t[size_];
-    end_ = new uint32_t[size_];
-    std::copy(node->start_.begin(), node->start_.end(), start_);
-    std::copy(node->end_.begin(), node->end_.end(), end_);
-    children_ = new CompactNode*[size_];
-    for (uint8_t i = 0; i < size_; i++) {
-      if (node->children_[i]->is_leaf_) {
-        children_[i] = new st::CompactLeafNode(((LeafNode *) node->children_[i]));
-      } else {
-        children_[i] = new st::CompactInternalNode(((InternalNode *) node->children_[i]));
-      }
-    }
-  }
+template<typename offset_t>
+class BasicCompactSuffixTree : public CompactSuffixTree {
+ public:
+  BasicCompactSuffixTree();
+  BasicCompactSuffixTree(const char *input, uint64_t size,
+                         uint32_t num_threads = 1);
+  ~BasicCompactSuffixTree();
 
-  size_t size() {
-    size_t subtree_size = 2 * sizeof(uint8_t) + size_ * (sizeof(uint32_t) * 2 + sizeof(CompactNode *));
-    for(uint8_t i = 0; i < size_; i++) {
-      subtree_size += children_[i]->size();
-    }
-    return subtree_size;
-  }
+  st::NodeId walkTree(const std::string& query) const;
+  void getOffsets(std::vector<int64_t>& results, st::NodeId node) const;
+  int64_t countLeaves(st::NodeId node) const;
 
-  uint8_t size_;
-  uint32_t* start_;
-  uint32_t* end_;
-  CompactNode** children_;
-};
-}
+  void matchingStatistics(std::vector<int64_t>& lengths,
+                          const std::string& pattern) const;
 
-class SuffixTree {
- public:
-  SuffixTree();
-  SuffixTree(const std::string& input);
-  SuffixTree(const char *input, size_t size);
-  ~SuffixTree();
+  char charAt(uint64_t i) const;
 
-  st::Node* walkTree(const std::string& query);
-  void getOffsets(std::vector<int64_t> &results, st::Node* node);
-  int64_t countLeaves(st::Node* node);
-  st::InternalNode* getRoot();
+  void compressText();
 
   size_t serialize(std::ostream& out);
   size_t deserialize(std::istream& in);
 
-#ifdef DEBUG_CONSTRUCT
-  void display() {
-    show(root_, 0);
-  }
-
-  void show(st::Node* node, uint32_t level) {
-    fprintf(stderr, "Level: %u, IsLeaf?: %d\n", level, node->is_leaf_);
-    if (node->is_leaf_)
-    return;
-
-    st::InternalNode* int_node = (st::InternalNode*) node;
-    for (uint32_t i = 0; i < int_node->children_.size(); i++) {
-      fprintf(stderr, "Path Label: ");
-      print(int_node->start_[i], int_node->end_[i]);
-      show(int_node->children_[i], level + 1);
-    }
-  }
-
-  void print(uint32_t s, uint32_t e) {
-    for (uint32_t i = s; i <= e; i++) {
-      fprintf(stderr, "%c", input_[i] == '\0' ? '$' : input_[i]);
-    }
-    fprintf(stderr, "\n");
-  }
-
-#endif
+ protected:
+  uint8_t offsetWidth() const;
 
  private:
-  void construct();
-  int32_t getChildId(st::InternalNode *node, char c);
-  void deleteTree(st::Node *node);
-
-  size_t writeNode(std::ostream& out, st::Node* node);
-  st::Node *readNode(std::istream& in, size_t *in_size);
-
-  st::InternalNode *root_;
-  const char* input_;
-  size_t size_;
+  // Leaf flag within the stored node references.
+  static const offset_t kLeaf = (offset_t) 1 << (8 * sizeof(offset_t) - 1);
+  // Nodes with at least this many children get a direct child table.
+  static const uint32_t kTableFanout = 32;
+  static const uint32_t kMaxTables = 65535;
+
+  // Nodes below the root built from a range of the suffix array that no
+  // internal node other than the root spans.
+  struct Subtrees;
+
+  void construct(const char* input, uint32_t num_threads);
+  void buildSubtrees(const char* input, const offset_t* lcp, offset_t lb,
+                     offset_t rb, Subtrees* part) const;
+  void buildChildTables();
+  void computeSuffixLinks(uint32_t num_threads);
+  // Index of the edge out of node starting with c, or -1.
+  int64_t getChildEdge(offset_t node, char c) const;
+
+  st::NodeId toNodeId(offset_t node) const;
+
+  template<typename T>
+  static size_t writeArray(std::ostream& out, const std::vector<T>& array);
+  template<typename T>
+  static size_t readArray(std::istream& in, std::vector<T>& array);
+
+  TextStore *text_;
+  uint64_t size_;
+  offset_t root_;
+
+  // The edges out of internal node i are [child_begin_[i], child_begin_[i + 1])
+  // in the edge arrays, sorted by first character. Edge labels are the text
+  // range [edge_start_, edge_end_], where position size_ is the terminator.
+  std::vector<offset_t> child_begin_;
+  std::vector<offset_t> edge_start_;
+  std::vector<offset_t> edge_end_;
+  std::vector<offset_t> edge_child_;
+  // First character of every edge label, kept inline so that choosing an
+  // edge does not touch the text. Zero for terminator edges.
+  std::vector<uint8_t> edge_char_;
+
+  // For nodes with high fanout, table_id_ is one more than the index of a
+  // 256-entry table mapping a character to one more than the position of
+  // its edge among the node's edges; zero means no table, or no edge.
+  std::vector<uint16_t> table_id_;
+  std::vector<uint16_t> child_table_;
+
+  // Text offset of every leaf. Leaves are in suffix array order, so the
+  // leaves below internal node i are [leaf_begin_[i], leaf_end_[i]).
+  std::vector<offset_t> leaf_offset_;
+  std::vector<offset_t> leaf_begin_;
+  std::vector<offset_t> leaf_end_;
+
+  // Suffix link of every internal node: the node whose path label is its
+  // own without the first character. The root links to itself.
+  std::vector<offset_t> suffix_link_;
 };
 
-class CompactSuffixTree {
- public:
-  CompactSuffixTree();
-  CompactSuffixTree(const char *input, uint32_t size);
-  CompactSuffixTree(const std::string& input);
-  ~CompactSuffixTree();
-
-  st::CompactNode* walkTree(const std::string& query);
-  void getOffsets(std::vector<int64_t>& results, st::CompactNode* node);
-  int64_t countLeaves(st::CompactNode* node);
-
-  char charAt(uint64_t i) const;
-
-  size_t serialize(std::ostream& out);
-  size_t deserialize(std::istream& in);
-
- private:
-  int32_t getChildId(st::CompactInternalNode *node, char c);
-  void deleteTree(st::CompactNode *node);
-
-  size_t writeNode(std::ostream& out, st::CompactNode* node);
-  st::CompactNode *readNode(std::istream& in, size_t *in_size);
-
-  st::CompactInternalNode* root_;
-  const char* input_;
-  uint32_t size_;
-
-  uint64_t num_internal_nodes_;
-  uint64_t num_leaf_nodes_;
-};
+typedef BasicCompactSuffixTree<uint32_t> CompactSuffixTree32;
+typedef BasicCompactSuffixTree<uint64_t> CompactSuffixTree64;
 
 }
 
@@ -8,20 +8,44 @@ namespace dsl {
 
 class CompressedSuffixTree : public dsl::TextIndex {
  public:
+  // Number of characters charAt decodes at once into its per-thread cursor
+  // once reads move forward.
+  static const uint64_t kExtractBlockSize = 256;
+
   CompressedSuffixTree();
-  CompressedSuffixTree(const std::string &input, const std::string& input_path, bool construct = true);
+  // The CSA samples every sample_rate-th suffix array entry, which trades
+  // space for the speed of locate and extract; 0 picks floor(log2(n)).
+  CompressedSuffixTree(const std::string &input, uint32_t sample_rate = 0);
+  ~CompressedSuffixTree();
 
   void search(std::vector<int64_t>& results, const std::string& query) const;
   int64_t count(const std::string& query) const;
   bool contains(const std::string& query) const;
 
+  // A read right after the last one decodes a block into a per-thread
+  // cursor that serves the reads after it, so a forward scan costs one LF
+  // step per character instead of a walk from the nearest sample each. Any
+  // other read decodes its character alone.
   char charAt(uint64_t i) const;
 
+  // Copies text[pos..pos+len) into buf without allocating; returns the
+  // number of characters copied, which is less than len at the end of the
+  // text.
+  uint64_t extract(char* buf, uint64_t pos, uint64_t len) const;
+
+  // Writes every component of the tree, so that loading needs neither the
+  // input text nor any construction work.
   size_t serialize(std::ostream& out);
   size_t deserialize(std::istream& in);
 
  private:
+  // Finds the suffix array range [*sp, *ep] of suffixes starting with query
+  // by backward search on the CSA; returns false if there is none.
+  bool getRange(const std::string& query, uint64_t* sp, uint64_t* ep) const;
+
   SSTree *cst_;
+  // Identifies this tree to the charAt cursors.
+  uint64_t id_;
 };
 
 }
@@ -0,0 +1,83 @@
+#ifndef DSL_TEXT_MULTIGRAM_INDEX_H_
+#define DSL_TEXT_MULTIGRAM_INDEX_H_
+
+#include <cstring>
+#include <vector>
+
+#include "compressed_postings.h"
+#include "text/text_index.h"
+#include "text_store.h"
+
+namespace dsl {
+
+// Posting lists for grams of varying length, picked by how selective they
+// are: a gram is indexed once it occurs at most max_postings times, and
+// extended by one more symbol otherwise, up to the longest gram a key can
+// hold. No indexed gram is a prefix of another, so every offset of the text
+// except the last few is in exactly one list. A query is covered by the
+// indexed grams it contains, picked to keep the lists it reads short, and
+// answered by intersecting their lists.
+class MultiGramIndex : public TextIndex {
+public:
+  static const uint64_t kDefaultMaxPostings = 1024;
+
+  MultiGramIndex();
+  MultiGramIndex(const std::string& input,
+                 uint64_t max_postings = kDefaultMaxPostings);
+  MultiGramIndex(const char* input, size_t size,
+                 uint64_t max_postings = kDefaultMaxPostings);
+  ~MultiGramIndex();
+
+  void search(std::vector<int64_t>& results, const std::string& query) const;
+  int64_t count(const std::string& query) const;
+  bool contains(const std::string& query) const;
+
+  char charAt(uint64_t i) const;
+
+  void compressText();
+
+  size_t serialize(std::ostream& out);
+  size_t deserialize(std::istream& in);
+
+private:
+  // Query offsets [begin, end) matched by lists [first, last), which hold
+  // a single gram or every gram that starts with the rest of the query.
+  struct Span {
+    uint64_t begin;
+    uint64_t end;
+    uint64_t first;
+    uint64_t last;
+  };
+
+  void constructMultiGramIndex(const char* input);
+
+  // Key of the first len symbols of str.
+  uint64_t encode(const char* str, uint32_t len) const;
+  uint32_t gramLength(uint64_t key) const;
+  // Keeps the bits of the first len symbols of a key.
+  uint64_t prefixMask(uint32_t len) const;
+
+  // Writes the offsets of span's grams less span.begin; in text order if
+  // sorted is set, else list by list.
+  void decodeSpan(const Span& span, std::vector<uint64_t>& out,
+                  bool sorted) const;
+  // Offsets of query, in text order unless one range of grams covers it.
+  void locate(const std::string& query, std::vector<uint64_t>& results) const;
+
+  TextStore *text_;
+  size_t size_;
+  uint64_t max_postings_;
+  uint32_t max_len_;
+  uint32_t bits_;
+
+  // Indexed grams in sorted order. A key packs one plus the alphabet code of
+  // each symbol, first symbol in the most significant bits and zeros past
+  // the last, so that keys order the same way as the grams and the grams
+  // starting with a string form a range.
+  std::vector<uint64_t> keys_;
+  // List i holds the offsets of keys_[i] in the text, in text order.
+  CompressedPostings *postings_;
+};
+}
+
+#endif
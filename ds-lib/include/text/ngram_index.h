@@ -1,43 +1,21 @@
 #ifndef DSL_TEXT_NGRAM_INDEX_H_
 #define DSL_TEXT_NGRAM_INDEX_H_
 
-#include <map>
 #include <cstring>
+#include <vector>
 
-#include "bitmap_array.h"
+#include "compressed_postings.h"
 #include "text/text_index.h"
+#include "text_store.h"
 
 namespace dsl {
 
-namespace ngram {
-  struct NGramComparator {
-    NGramComparator() {
-      n_ = 3;
-    }
-
-    NGramComparator(uint32_t n) {
-      n_ = n;
-    }
-
-    bool operator() (char *a, char *b) const {
-      for(size_t i = 0; i < n_; i++) {
-        if(a[i] < b[i]) return true;
-        else if(a[i] > b[i]) return false;
-      }
-      return false;
-    }
-
-    uint32_t n_;
-  };
-};
-
 class NGramIndex : public TextIndex {
 public:
-  typedef std::map<char*, BitmapArray*, ngram::NGramComparator> NGramMap;
-
   NGramIndex();
   NGramIndex(const std::string& input, uint32_t n = 3);
   NGramIndex(const char* input, size_t size, uint32_t n = 3);
+  ~NGramIndex();
 
   void search(std::vector<int64_t>& results, const std::string& query) const;
   int64_t count(const std::string& query) const;
@@ -45,18 +23,37 @@ public:
 
   char charAt(uint64_t i) const;
 
+  void compressText();
+
   size_t serialize(std::ostream& out);
   size_t deserialize(std::istream& in);
 
 private:
-  void constructNGramIndex();
-  bool match(const char* str1, const char* str2, size_t len) const;
-  bool nGramStartsWith(char* ngram, char *substr) const;
-
-  const char* input_;
+  void constructNGramIndex(const char* input);
+
+  // Range [first, second) of keys_ whose n-grams start with the first
+  // min(len, n) symbols of query; their postings are contiguous.
+  std::pair<uint64_t, uint64_t> getRange(const std::string& query) const;
+  // Offsets past the last full n-gram, which prefix queries check directly.
+  uint64_t tailStart() const;
+  // Keeps the low n * bits_ bits of a rolling n-gram key.
+  uint64_t keyMask() const;
+  // Offsets of query, longer than n, in text order; intersects the posting
+  // lists of its n-grams instead of checking the text.
+  void locateLong(const std::string& query,
+                  std::vector<uint64_t>& results) const;
+
+  TextStore *text_;
   size_t size_;
   uint32_t n_;
-  NGramMap map_;
+  uint32_t bits_;
+
+  // Distinct n-grams in sorted order, each keyed by the alphabet codes of
+  // its symbols packed into a single word, first symbol in the most
+  // significant bits, so that keys order the same way as the n-grams.
+  std::vector<uint64_t> keys_;
+  // List i holds the offsets of keys_[i] in the text, in text order.
+  CompressedPostings *postings_;
 };
 }
 
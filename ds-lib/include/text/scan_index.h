@@ -0,0 +1,49 @@
+#ifndef DSL_TEXT_SCAN_INDEX_H_
+#define DSL_TEXT_SCAN_INDEX_H_
+
+#include <functional>
+#include <string>
+
+#include "text/text_index.h"
+
+namespace dsl {
+
+// Answers every query by scanning the raw text with SubstringSearch, split
+// into fixed-size chunks that are handed out to a pool of threads. Needs no
+// construction, which makes it both a baseline for the other indexes and a
+// way to query files that have not been indexed. Keeps its own copy of the
+// text.
+class ScanIndex : public TextIndex {
+ public:
+  // A num_threads of 0 uses all hardware threads.
+  ScanIndex(uint32_t num_threads = 0);
+  ScanIndex(const std::string& input, uint32_t num_threads = 0);
+  ScanIndex(const char* input, size_t size, uint32_t num_threads = 0);
+  ~ScanIndex();
+
+  void search(std::vector<int64_t>& results, const std::string& query) const;
+  int64_t count(const std::string& query) const;
+  bool contains(const std::string& query) const;
+
+  char charAt(uint64_t i) const;
+
+  size_t serialize(std::ostream& out);
+  size_t deserialize(std::istream& in);
+
+ private:
+  static const uint64_t kChunkSize = 1ULL << 22;
+
+  uint64_t numChunks(const std::string& query) const;
+  // Runs task on chunks 0..num_chunks-1 across threads; stops handing out
+  // chunks once some task returns false.
+  void forEachChunk(uint64_t num_chunks,
+                    const std::function<bool(uint64_t)>& task) const;
+
+  char* input_;
+  size_t size_;
+  uint32_t num_threads_;
+};
+
+}
+
+#endif // DSL_TEXT_SCAN_INDEX_H_
@@ -0,0 +1,57 @@
+#ifndef DSL_TEXT_SPARSE_SUFFIX_ARRAY_INDEX_H_
+#define DSL_TEXT_SPARSE_SUFFIX_ARRAY_INDEX_H_
+
+#include <string>
+
+#include "text/text_index.h"
+#include "bitmap_array.h"
+
+namespace dsl {
+
+// Suffix array over only those suffixes that start at position 0 or right
+// after one of a set of boundary characters (e.g. field and record
+// delimiters). Queries containing a boundary character are answered entirely
+// through the index; all other queries fall back to scanning the text with
+// SubstringSearch.
+class SparseSuffixArrayIndex : public TextIndex {
+ public:
+  SparseSuffixArrayIndex();
+  SparseSuffixArrayIndex(const std::string& input,
+                         const std::string& boundaries = "|\n");
+  SparseSuffixArrayIndex(const char* input, size_t size,
+                         const std::string& boundaries = "|\n");
+  ~SparseSuffixArrayIndex();
+
+  void search(std::vector<int64_t>& results, const std::string& query) const;
+  int64_t count(const std::string& query) const;
+  bool contains(const std::string& query) const;
+
+  // Only report occurrences that start at a boundary.
+  void searchAnchored(std::vector<int64_t>& results,
+                      const std::string& query) const;
+  int64_t countAnchored(const std::string& query) const;
+
+  char charAt(uint64_t i) const;
+
+  size_t serialize(std::ostream& out);
+  size_t deserialize(std::istream& in);
+
+ private:
+  void setBoundaries(const std::string& boundaries);
+  void construct();
+
+  int32_t compare(const char* query, size_t len, uint64_t pos) const;
+  std::pair<int64_t, int64_t> getRange(const char* query, size_t len) const;
+  int64_t getAnchor(const std::string& query) const;
+  bool matchAt(const char* query, size_t len, uint64_t pos) const;
+
+  BitmapArray *sa_;
+  char* input_;
+  size_t size_;
+  std::string boundaries_;
+  bool is_boundary_[256];
+};
+
+}
+
+#endif // DSL_TEXT_SPARSE_SUFFIX_ARRAY_INDEX_H_
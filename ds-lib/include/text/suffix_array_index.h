@@ -3,15 +3,31 @@
 
 #include "text/text_index.h"
 #include "suffix_array.h"
+#include "text_store.h"
+#include "piecewise_linear_model.h"
+#include "prefix_trie.h"
 
 namespace dsl {
 class SuffixArrayIndex : public TextIndex {
  public:
+  // How getRange narrows down the part of the suffix array it binary
+  // searches.
+  enum RangeSearchType {
+    // Binary search over the whole suffix array.
+    kBinarySearch = 0,
+    // Table of suffix array ranges for every 2-byte prefix.
+    kBucketSearch = 1,
+    // Piecewise-linear model from 8-byte prefixes to suffix array positions.
+    kLearnedSearch = 2
+  };
+
   SuffixArrayIndex();
   SuffixArrayIndex(const std::string& input);
+  // Takes ownership of suffix_array.
   SuffixArrayIndex(const std::string& input, SuffixArray* suffix_array);
   SuffixArrayIndex(const char* input, size_t size);
   SuffixArrayIndex(const char* input, size_t size, SuffixArray* suffix_array);
+  ~SuffixArrayIndex();
 
   void search(std::vector<int64_t>& results, const std::string& query) const;
   int64_t count(const std::string& query) const;
@@ -19,28 +35,63 @@ class SuffixArrayIndex : public TextIndex {
 
   char charAt(uint64_t i) const;
 
+  void compressText();
+
   size_t serialize(std::ostream& out);
   size_t deserialize(std::istream& in);
 
+  // Builds whatever the given search type needs, if not built already. The
+  // choice is persisted by serialize().
+  void setRangeSearchType(RangeSearchType type);
+  RangeSearchType getRangeSearchType() const;
+
+  // Puts a PrefixTrie over the first max_depth characters of the suffixes in
+  // front of the range search, or removes it for a max_depth of 0. Persisted
+  // by serialize().
+  void buildPrefixTrie(uint32_t max_depth,
+                       uint64_t max_nodes = PrefixTrie::kDefaultMaxNodes);
+
  protected:
   virtual std::pair<int64_t, int64_t> getRange(const std::string& query) const;
   int32_t compare(const std::string& query, uint64_t pos) const;
 
   SuffixArray *sa_;
-  const char* input_;
+  TextStore *text_;
   size_t size_;
+  PrefixTrie *trie_;
+
+ private:
+  static const uint64_t kNumBuckets = 1 << 16;
+
+  // Searches for the query within sa_[lo..hi).
+  std::pair<int64_t, int64_t> binarySearch(const std::string& query,
+                                           int64_t lo, int64_t hi) const;
+
+  // First 8 bytes of the suffix at pos, big-endian and zero-padded.
+  uint64_t prefixKey(uint64_t pos) const;
+  // Index of the first suffix whose prefix key is >= key.
+  int64_t lowerBound(uint64_t key) const;
+
+  void buildBuckets();
+  void buildModel();
+
+  RangeSearchType range_search_type_;
+  BitmapArray *buckets_;
+  PiecewiseLinearModel *model_;
 };
 
 class AugmentedSuffixArrayIndex : public SuffixArrayIndex {
  public:
   AugmentedSuffixArrayIndex();
   AugmentedSuffixArrayIndex(const std::string& input);
+  // Takes ownership of suffix_array, lcp_l and lcp_r.
   AugmentedSuffixArrayIndex(const std::string& input, SuffixArray* suffix_array,
                             BitmapArray* lcp_l, BitmapArray* lcp_r);
   AugmentedSuffixArrayIndex(const char* input, size_t size);
   AugmentedSuffixArrayIndex(const char* input, size_t size,
                             SuffixArray* suffix_array, BitmapArray* lcp_l,
                             BitmapArray* lcp_r);
+  ~AugmentedSuffixArrayIndex();
 
   size_t serialize(std::ostream& out);
   size_t deserialize(std::istream& in);
@@ -9,15 +9,23 @@ namespace dsl {
 class SuffixTreeIndex : public TextIndex {
  public:
   SuffixTreeIndex();
-  SuffixTreeIndex(const char *input, size_t size);
-  SuffixTreeIndex(const std::string& input);
+  // Builds on num_threads threads; 0 uses all hardware threads.
+  SuffixTreeIndex(const char *input, size_t size, uint32_t num_threads = 1);
+  SuffixTreeIndex(const std::string& input, uint32_t num_threads = 1);
 
   virtual void search(std::vector<int64_t>& result, const std::string& query) const;
   virtual int64_t count(const std::string& query) const;
   virtual bool contains(const std::string& query) const;
 
+  // lengths[i] becomes the length of the longest prefix of pattern[i..] that
+  // occurs in the text, in time linear in the length of the pattern.
+  void matchingStatistics(std::vector<int64_t>& lengths,
+                          const std::string& pattern) const;
+
   char charAt(uint64_t i) const;
 
+  void compressText();
+
   virtual size_t serialize(std::ostream& out);
   virtual size_t deserialize(std::istream& in);
 
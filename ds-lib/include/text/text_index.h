@@ -5,6 +5,8 @@
 #include <vector>
 #include <iostream>
 
+#include "alphabet.h"
+
 namespace dsl {
 
 class TextIndex {
@@ -21,8 +23,21 @@ class TextIndex {
 
   virtual char charAt(uint64_t i) const = 0;
 
+  // Replaces the copy of the text kept by the index with a compressed one,
+  // for indexes that support it; a no-op otherwise.
+  virtual void compressText() {
+  }
+
   virtual size_t serialize(std::ostream& out) = 0;
   virtual size_t deserialize(std::istream& in) = 0;
+
+  // Symbols that occur in the indexed text.
+  const Alphabet& alphabet() const {
+    return alphabet_;
+  }
+
+ protected:
+  Alphabet alphabet_;
 };
 
 }
@@ -0,0 +1,93 @@
+#ifndef DSL_TEXT_STORE_H_
+#define DSL_TEXT_STORE_H_
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace dsl {
+
+// Random access to the indexed text, independent of how it is stored.
+// Stores that keep the raw bytes expose them through data(), which lets the
+// accessors below skip the virtual decode path entirely.
+class TextStore {
+ public:
+  enum StoreType {
+    kPlain = 0,
+    kCompressed = 1
+  };
+
+  TextStore() {
+    data_ = NULL;
+    size_ = 0;
+  }
+
+  virtual ~TextStore() {
+  }
+
+  virtual StoreType type() const = 0;
+
+  uint64_t size() const {
+    return size_;
+  }
+
+  // The raw text, or NULL if it is not stored uncompressed.
+  const char* data() const {
+    return data_;
+  }
+
+  char charAt(uint64_t i) const {
+    return data_ != NULL ? data_[i] : decodeAt(i);
+  }
+
+  // Copies text[pos..pos+len) into buf.
+  void extract(char* buf, uint64_t pos, uint64_t len) const {
+    if (data_ != NULL)
+      memcpy(buf, data_ + pos, len);
+    else
+      decode(buf, pos, len);
+  }
+
+  // Returns true if text[pos..pos+len) equals str; false if it runs past the
+  // end of the text.
+  bool matches(const char* str, uint64_t pos, uint64_t len) const;
+
+  virtual size_t serialize(std::ostream& out) = 0;
+  virtual size_t deserialize(std::istream& in) = 0;
+
+  // Writes store preceded by its type, so that readStore can recreate it.
+  static size_t writeStore(std::ostream& out, TextStore* store);
+  static TextStore* readStore(std::istream& in, size_t* in_size);
+
+ protected:
+  virtual char decodeAt(uint64_t i) const = 0;
+  virtual void decode(char* buf, uint64_t pos, uint64_t len) const = 0;
+
+  const char* data_;
+  uint64_t size_;
+};
+
+// Keeps the text as is, in a copy of its own, so that indexes built on a
+// caller's buffer outlive it.
+class PlainTextStore : public TextStore {
+ public:
+  PlainTextStore();
+  PlainTextStore(const char* input, size_t size);
+  ~PlainTextStore();
+
+  StoreType type() const;
+
+  size_t serialize(std::ostream& out);
+  size_t deserialize(std::istream& in);
+
+ protected:
+  char decodeAt(uint64_t i) const;
+  void decode(char* buf, uint64_t pos, uint64_t len) const;
+
+ private:
+  bool owns_data_;
+};
+
+}
+
+#endif // DSL_TEXT_STORE_H_
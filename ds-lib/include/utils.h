@@ -37,6 +37,14 @@ namespace dsl {
 #define hff  0xffffffffffffffff //binary: all ones
 #define h01  0x0101010101010101 //the sum of 256 to the power of 0,1,2,3...
 
+/* Compile a function with and without the popcnt instruction, and pick the
+ * one the CPU supports when the program is loaded */
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__linux__)
+#define DSL_POPCNT_CLONES __attribute__((target_clones("popcnt", "default")))
+#else
+#define DSL_POPCNT_CLONES
+#endif
+
 class Utils {
  public:
   // Returns the number of set bits in a 64 bit integer
@@ -0,0 +1,79 @@
+#include "alphabet.h"
+
+#include <cstring>
+
+#include "utils.h"
+
+dsl::Alphabet::Alphabet() {
+  buildCodes();
+}
+
+dsl::Alphabet::Alphabet(const char* input, size_t size) {
+  bool present[256] = { false };
+  for (size_t i = 0; i < size; i++) {
+    present[(uint8_t) input[i]] = true;
+  }
+  for (uint32_t c = 0; c < 256; c++) {
+    if (present[c])
+      symbols_ += (char) c;
+  }
+  buildCodes();
+}
+
+void dsl::Alphabet::buildCodes() {
+  memset(present_, 0, sizeof(present_));
+  memset(codes_, 0, sizeof(codes_));
+  for (uint32_t i = 0; i < symbols_.length(); i++) {
+    present_[(uint8_t) symbols_[i]] = true;
+    codes_[(uint8_t) symbols_[i]] = i;
+  }
+}
+
+bool dsl::Alphabet::containsAll(const std::string& str) const {
+  for (auto c : str) {
+    if (!present_[(uint8_t) c])
+      return false;
+  }
+  return true;
+}
+
+uint32_t dsl::Alphabet::size() const {
+  return symbols_.length();
+}
+
+uint32_t dsl::Alphabet::bitsPerSymbol() const {
+  return MAX(Utils::int_log_2(symbols_.length()), 1);
+}
+
+const std::string& dsl::Alphabet::symbols() const {
+  return symbols_;
+}
+
+size_t dsl::Alphabet::serialize(std::ostream& out) {
+  size_t out_size = 0;
+
+  uint32_t num_symbols = symbols_.length();
+  out.write(reinterpret_cast<const char *>(&num_symbols), sizeof(uint32_t));
+  out_size += sizeof(uint32_t);
+
+  out.write(symbols_.c_str(), num_symbols * sizeof(char));
+  out_size += num_symbols * sizeof(char);
+
+  return out_size;
+}
+
+size_t dsl::Alphabet::deserialize(std::istream& in) {
+  size_t in_size = 0;
+
+  uint32_t num_symbols;
+  in.read(reinterpret_cast<char *>(&num_symbols), sizeof(uint32_t));
+  in_size += sizeof(uint32_t);
+
+  symbols_.resize(num_symbols);
+  in.read(&symbols_[0], num_symbols * sizeof(char));
+  in_size += num_symbols * sizeof(char);
+
+  buildCodes();
+
+  return in_size;
+}
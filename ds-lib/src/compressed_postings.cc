@@ -0,0 +1,303 @@
+#include "compressed_postings.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "utils.h"
+
+namespace {
+
+const uint64_t kBlockSize = dsl::CompressedPostings::kBlockSize;
+
+// Value i of a block goes to lane i % 4, at bit (i / 4) * width of that
+// lane; word w of lane j is 32-bit word 4 * w + j of the block.
+void packBlock(const uint32_t* in, uint32_t width, uint32_t* out) {
+  memset(out, 0, 4 * width * sizeof(uint32_t));
+  for (uint64_t i = 0; i < kBlockSize; i++) {
+    uint64_t bit = (i / 4) * width, lane = i % 4;
+    uint64_t word = 4 * (bit / 32) + lane;
+    out[word] |= in[i] << (bit % 32);
+    if (bit % 32 + width > 32)
+      out[word + 4] |= in[i] >> (32 - bit % 32);
+  }
+}
+
+// Unpacks the deltas of a block and turns them into values relative to the
+// block's first one.
+void unpackBlock(const uint32_t* in, uint32_t width, uint32_t* out) {
+  if (width == 0) {
+    memset(out, 0, kBlockSize * sizeof(uint32_t));
+    return;
+  }
+#ifdef __SSE2__
+  const __m128i *words = reinterpret_cast<const __m128i *>(in);
+  const __m128i mask = _mm_set1_epi32(
+      width == 32 ? ~0U : (1U << width) - 1);
+  __m128i cur = _mm_loadu_si128(words++);
+  __m128i sum = _mm_setzero_si128();
+  uint32_t shift = 0;
+  for (uint64_t i = 0; i < kBlockSize / 4; i++) {
+    __m128i v = _mm_srl_epi32(cur, _mm_cvtsi32_si128(shift));
+    shift += width;
+    if (shift >= 32) {
+      shift -= 32;
+      // The last group ends exactly on a word boundary.
+      if (i + 1 < kBlockSize / 4)
+        cur = _mm_loadu_si128(words++);
+      if (shift > 0)
+        v = _mm_or_si128(v, _mm_sll_epi32(cur,
+                                          _mm_cvtsi32_si128(width - shift)));
+    }
+    v = _mm_and_si128(v, mask);
+
+    // Prefix sum over the four lanes, carrying the previous group's last.
+    v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+    v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+    v = _mm_add_epi32(v, sum);
+    sum = _mm_shuffle_epi32(v, 0xFF);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4 * i), v);
+  }
+#else
+  uint32_t mask = width == 32 ? ~0U : (1U << width) - 1;
+  uint32_t sum = 0;
+  for (uint64_t i = 0; i < kBlockSize; i++) {
+    uint64_t bit = (i / 4) * width, lane = i % 4;
+    uint64_t word = 4 * (bit / 32) + lane;
+    uint32_t v = in[word] >> (bit % 32);
+    if (bit % 32 + width > 32)
+      v |= in[word + 4] << (32 - bit % 32);
+    sum += v & mask;
+    out[i] = sum;
+  }
+#endif
+}
+
+// First index in [lo, hi) of the increasing array a with a[i] >= key, found
+// by doubling steps from lo and then a binary search.
+uint64_t gallop(const uint64_t* a, uint64_t lo, uint64_t hi, uint64_t key) {
+  uint64_t step = 1;
+  while (lo + step < hi && a[lo + step] < key) {
+    lo += step;
+    step *= 2;
+  }
+  return std::lower_bound(a + lo, a + MIN(lo + step, hi), key) - a;
+}
+
+void writeVarint(std::vector<uint8_t>& data, uint64_t value) {
+  while (value >= 128) {
+    data.push_back((value & 127) | 128);
+    value >>= 7;
+  }
+  data.push_back(value);
+}
+
+uint64_t readVarint(const uint8_t*& p) {
+  uint64_t value = 0;
+  for (uint32_t shift = 0; ; shift += 7) {
+    uint8_t byte = *p++;
+    value |= (uint64_t) (byte & 127) << shift;
+    if (byte < 128)
+      return value;
+  }
+}
+
+template<typename T>
+size_t writeVector(std::ostream& out, const std::vector<T>& v) {
+  uint64_t size = v.size();
+  out.write(reinterpret_cast<const char *>(&size), sizeof(uint64_t));
+  out.write(reinterpret_cast<const char *>(v.data()), size * sizeof(T));
+  return sizeof(uint64_t) + size * sizeof(T);
+}
+
+template<typename T>
+size_t readVector(std::istream& in, std::vector<T>& v) {
+  uint64_t size;
+  in.read(reinterpret_cast<char *>(&size), sizeof(uint64_t));
+  v.resize(size);
+  in.read(reinterpret_cast<char *>(v.data()), size * sizeof(T));
+  return sizeof(uint64_t) + size * sizeof(T);
+}
+
+}
+
+dsl::CompressedPostings::CompressedPostings() {
+  offsets_.push_back(0);
+  blocks_.push_back(0);
+}
+
+dsl::CompressedPostings::CompressedPostings(
+    const uint64_t* values, const std::vector<uint64_t>& offsets)
+    : CompressedPostings() {
+  for (uint64_t list = 0; list + 1 < offsets.size(); list++) {
+    uint64_t begin = offsets[list], end = offsets[list + 1];
+    uint64_t i = begin;
+    for (; i + kBlockSize <= end; i += kBlockSize) {
+      encodeBlock(values + i);
+    }
+    tails_.push_back(data_.size());
+    uint64_t prev = i > begin ? values[i - 1] : 0;
+    for (; i < end; i++) {
+      writeVarint(data_, values[i] - prev);
+      prev = values[i];
+    }
+    offsets_.push_back(end);
+    blocks_.push_back(block_first_.size());
+  }
+}
+
+void dsl::CompressedPostings::encodeBlock(const uint64_t* values) {
+  block_first_.push_back(values[0]);
+  block_data_.push_back(data_.size());
+
+  size_t pos = data_.size();
+  if (values[kBlockSize - 1] - values[0] > UINT32_MAX) {
+    data_.push_back(kRawBlock);
+    data_.resize(pos + 1 + kBlockSize * sizeof(uint64_t));
+    memcpy(&data_[pos + 1], values, kBlockSize * sizeof(uint64_t));
+    return;
+  }
+
+  uint32_t deltas[kBlockSize];
+  uint32_t max_delta = 0;
+  deltas[0] = 0;
+  for (uint64_t i = 1; i < kBlockSize; i++) {
+    deltas[i] = values[i] - values[i - 1];
+    max_delta = MAX(max_delta, deltas[i]);
+  }
+  uint32_t width = Utils::int_log_2((uint64_t) max_delta + 1);
+  std::vector<uint32_t> packed(4 * width);
+  packBlock(deltas, width, packed.data());
+
+  data_.push_back(width);
+  data_.resize(pos + 1 + packed.size() * sizeof(uint32_t));
+  memcpy(&data_[pos + 1], packed.data(), packed.size() * sizeof(uint32_t));
+}
+
+void dsl::CompressedPostings::decodeBlock(uint64_t block,
+                                          uint64_t* out) const {
+  const uint8_t *p = &data_[block_data_[block]];
+  uint8_t width = *p++;
+  if (width == kRawBlock) {
+    memcpy(out, p, kBlockSize * sizeof(uint64_t));
+    return;
+  }
+
+  uint32_t rel[kBlockSize];
+  unpackBlock(reinterpret_cast<const uint32_t *>(p), width, rel);
+  uint64_t first = block_first_[block];
+  for (uint64_t i = 0; i < kBlockSize; i++) {
+    out[i] = first + rel[i];
+  }
+}
+
+uint64_t dsl::CompressedPostings::numLists() const {
+  return tails_.size();
+}
+
+uint64_t dsl::CompressedPostings::offset(uint64_t list) const {
+  return offsets_[list];
+}
+
+uint64_t dsl::CompressedPostings::size(uint64_t list) const {
+  return offsets_[list + 1] - offsets_[list];
+}
+
+uint64_t dsl::CompressedPostings::decodeTail(uint64_t list, uint64_t prev,
+                                             uint64_t* out) const {
+  uint64_t num_blocks = blocks_[list + 1] - blocks_[list];
+  uint64_t n = size(list) - num_blocks * kBlockSize;
+  const uint8_t *p = data_.data() + tails_[list];
+  for (uint64_t i = 0; i < n; i++) {
+    prev += readVarint(p);
+    out[i] = prev;
+  }
+  return n;
+}
+
+void dsl::CompressedPostings::decode(uint64_t list, uint64_t* out) const {
+  for (uint64_t block = blocks_[list]; block < blocks_[list + 1]; block++) {
+    decodeBlock(block, out);
+    out += kBlockSize;
+  }
+  decodeTail(list, blocks_[list] < blocks_[list + 1] ? out[-1] : 0, out);
+}
+
+void dsl::CompressedPostings::intersect(uint64_t list, uint64_t shift,
+                                        std::vector<uint64_t>& values) const {
+  uint64_t first_block = blocks_[list], end_block = blocks_[list + 1];
+  const uint64_t *firsts = block_first_.data();
+
+  // Values of the block being searched; block end_block is the tail.
+  uint64_t buf[kBlockSize];
+  uint64_t buf_size = 0, buf_block = UINT64_MAX, pos = 0;
+  uint64_t block = first_block;
+  size_t kept = 0;
+  for (size_t i = 0; i < values.size(); i++) {
+    uint64_t target = values[i] + shift;
+
+    if (buf_block != end_block) {
+      // The last block starting at or before target; targets only grow, so
+      // the search resumes where the previous one ended.
+      uint64_t next = gallop(firsts, block, end_block, target + 1);
+      if (next == first_block && first_block < end_block)
+        continue;
+      uint64_t b = next > first_block ? next - 1 : end_block;
+      if (b < end_block) {
+        block = b;
+        if (b != buf_block) {
+          decodeBlock(b, buf);
+          buf_size = kBlockSize;
+          buf_block = b;
+          pos = 0;
+        }
+        if (target > buf[kBlockSize - 1]) {
+          if (b + 1 < end_block)
+            continue;
+          // Past the last full block
+          b = end_block;
+        }
+      }
+      if (b == end_block) {
+        uint64_t prev = buf_block < end_block ? buf[kBlockSize - 1] : 0;
+        buf_size = decodeTail(list, prev, buf);
+        buf_block = end_block;
+        pos = 0;
+      }
+    }
+
+    pos = gallop(buf, pos, buf_size, target);
+    if (pos < buf_size && buf[pos] == target)
+      values[kept++] = values[i];
+  }
+  values.resize(kept);
+}
+
+size_t dsl::CompressedPostings::serialize(std::ostream& out) {
+  size_t out_size = 0;
+
+  out_size += writeVector(out, offsets_);
+  out_size += writeVector(out, blocks_);
+  out_size += writeVector(out, tails_);
+  out_size += writeVector(out, block_first_);
+  out_size += writeVector(out, block_data_);
+  out_size += writeVector(out, data_);
+
+  return out_size;
+}
+
+size_t dsl::CompressedPostings::deserialize(std::istream& in) {
+  size_t in_size = 0;
+
+  in_size += readVector(in, offsets_);
+  in_size += readVector(in, blocks_);
+  in_size += readVector(in, tails_);
+  in_size += readVector(in, block_first_);
+  in_size += readVector(in, block_data_);
+  in_size += readVector(in, data_);
+
+  return in_size;
+}
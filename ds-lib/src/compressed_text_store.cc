@@ -0,0 +1,298 @@
+#include "compressed_text_store.h"
+
+#include <algorithm>
+#include <atomic>
+#include <queue>
+
+#include "utils.h"
+
+namespace {
+
+struct DecodeCacheEntry {
+  uint64_t store_id;
+  uint64_t block;
+  char data[dsl::CompressedTextStore::kBlockSize];
+};
+
+// Direct-mapped on the block number. A store id of 0 marks an empty entry.
+thread_local DecodeCacheEntry decode_cache[
+    dsl::CompressedTextStore::kCacheEntries];
+
+std::atomic<uint64_t> next_store_id(1);
+
+}
+
+dsl::CompressedTextStore::CompressedTextStore() {
+  memset(code_lengths_, 0, sizeof(code_lengths_));
+  memset(codes_, 0, sizeof(codes_));
+  memset(decode_table_, 0, sizeof(decode_table_));
+  block_offsets_ = NULL;
+  id_ = next_store_id++;
+}
+
+dsl::CompressedTextStore::CompressedTextStore(const char* input, size_t size)
+    : CompressedTextStore() {
+  size_ = size;
+
+  uint64_t freqs[256] = { 0 };
+  for (size_t i = 0; i < size; i++) {
+    freqs[(uint8_t) input[i]]++;
+  }
+  computeCodeLengths(freqs);
+  buildCodes();
+  encode(input);
+}
+
+dsl::CompressedTextStore::~CompressedTextStore() {
+  delete block_offsets_;
+}
+
+dsl::TextStore::StoreType dsl::CompressedTextStore::type() const {
+  return kCompressed;
+}
+
+void dsl::CompressedTextStore::computeCodeLengths(const uint64_t* freqs) {
+  // Plain Huffman construction; nodes 0-255 are the symbols, internal nodes
+  // are numbered from 256 on.
+  typedef std::pair<uint64_t, uint32_t> Node;
+  std::priority_queue<Node, std::vector<Node>, std::greater<Node>> queue;
+  std::vector<uint32_t> parent(512, 0);
+  for (uint32_t c = 0; c < 256; c++) {
+    if (freqs[c] > 0)
+      queue.push(Node(freqs[c], c));
+  }
+
+  memset(code_lengths_, 0, sizeof(code_lengths_));
+  if (queue.size() == 1) {
+    code_lengths_[queue.top().second] = 1;
+    return;
+  }
+
+  uint32_t next = 256;
+  while (queue.size() > 1) {
+    Node a = queue.top();
+    queue.pop();
+    Node b = queue.top();
+    queue.pop();
+    parent[a.second] = parent[b.second] = next;
+    queue.push(Node(a.first + b.first, next++));
+  }
+  uint32_t root = next - 1;
+
+  std::vector<uint32_t> symbols;
+  for (uint32_t c = 0; c < 256; c++) {
+    if (freqs[c] == 0)
+      continue;
+    uint32_t len = 0;
+    for (uint32_t node = c; node != root; node = parent[node]) {
+      len++;
+    }
+    code_lengths_[c] = MIN(len, kMaxCodeLength);
+    symbols.push_back(c);
+  }
+
+  // Clamping long codes over-subscribes the code space; lengthen the
+  // longest codes that still have room, rarest first, until it fits again.
+  uint64_t capacity = 1ULL << kMaxCodeLength, used = 0;
+  for (auto c : symbols) {
+    used += 1ULL << (kMaxCodeLength - code_lengths_[c]);
+  }
+  std::sort(symbols.begin(), symbols.end(), [freqs](uint32_t a, uint32_t b) {
+    return freqs[a] < freqs[b];
+  });
+  while (used > capacity) {
+    uint32_t best = 256;
+    for (auto c : symbols) {
+      if (code_lengths_[c] < kMaxCodeLength
+          && (best == 256 || code_lengths_[c] > code_lengths_[best]))
+        best = c;
+    }
+    used -= 1ULL << (kMaxCodeLength - code_lengths_[best] - 1);
+    code_lengths_[best]++;
+  }
+}
+
+void dsl::CompressedTextStore::buildCodes() {
+  // Canonical codes: ordered by length, then by symbol.
+  std::vector<uint32_t> symbols;
+  for (uint32_t c = 0; c < 256; c++) {
+    if (code_lengths_[c] > 0)
+      symbols.push_back(c);
+  }
+  std::sort(symbols.begin(), symbols.end(), [this](uint32_t a, uint32_t b) {
+    return code_lengths_[a] < code_lengths_[b]
+        || (code_lengths_[a] == code_lengths_[b] && a < b);
+  });
+
+  memset(codes_, 0, sizeof(codes_));
+  memset(decode_table_, 0, sizeof(decode_table_));
+  uint32_t code = 0, prev_len = 0;
+  for (auto c : symbols) {
+    code <<= code_lengths_[c] - prev_len;
+    prev_len = code_lengths_[c];
+    codes_[c] = code++;
+
+    uint32_t shift = kMaxCodeLength - code_lengths_[c];
+    uint16_t entry = c | (code_lengths_[c] << 8);
+    for (uint32_t i = 0; i < (1U << shift); i++) {
+      decode_table_[(codes_[c] << shift) | i] = entry;
+    }
+  }
+}
+
+void dsl::CompressedTextStore::encode(const char* input) {
+  uint64_t num_blocks = (size_ + kBlockSize - 1) / kBlockSize;
+  std::vector<uint64_t> offsets(num_blocks);
+
+  bits_.clear();
+  uint64_t pos = 0, word = 0;
+  for (uint64_t i = 0; i < size_; i++) {
+    if (i % kBlockSize == 0)
+      offsets[i / kBlockSize] = pos;
+
+    uint8_t c = input[i];
+    uint32_t len = code_lengths_[c];
+    uint32_t used = pos % 64;
+    // Codes are written most significant bit first.
+    if (used + len <= 64) {
+      word |= (uint64_t) codes_[c] << (64 - used - len);
+    } else {
+      uint32_t spill = used + len - 64;
+      word |= (uint64_t) codes_[c] >> spill;
+      bits_.push_back(word);
+      word = (uint64_t) codes_[c] << (64 - spill);
+    }
+    pos += len;
+    if (used + len == 64) {
+      bits_.push_back(word);
+      word = 0;
+    }
+  }
+  bits_.push_back(word);
+  // Padding, so that a lookup may always read the word after its own.
+  bits_.push_back(0);
+
+  delete block_offsets_;
+  block_offsets_ = new BitmapArray(num_blocks, Utils::int_log_2(pos + 1));
+  for (uint64_t i = 0; i < num_blocks; i++) {
+    block_offsets_->insert(i, offsets[i]);
+  }
+}
+
+void dsl::CompressedTextStore::decodeBlock(uint64_t block, char* buf,
+                                           uint64_t n) const {
+  uint64_t pos = block_offsets_->at(block);
+  const uint64_t *bits = bits_.data();
+  uint64_t window = 0;
+  uint32_t avail = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    // Refill with the next 64 bits once the window may hold less than a
+    // whole code.
+    if (avail < kMaxCodeLength) {
+      uint64_t w = pos / 64, off = pos % 64;
+      window = bits[w] << off;
+      if (off != 0)
+        window |= bits[w + 1] >> (64 - off);
+      avail = 64;
+    }
+    uint16_t entry = decode_table_[window >> (64 - kMaxCodeLength)];
+    uint32_t len = entry >> 8;
+    buf[i] = (char) (entry & 0xFF);
+    window <<= len;
+    avail -= len;
+    pos += len;
+  }
+}
+
+uint64_t dsl::CompressedTextStore::blockLength(uint64_t block) const {
+  return MIN(kBlockSize, size_ - block * kBlockSize);
+}
+
+const char* dsl::CompressedTextStore::cachedBlock(uint64_t block) const {
+  DecodeCacheEntry *entry = &decode_cache[block % kCacheEntries];
+  if (entry->store_id != id_ || entry->block != block) {
+    decodeBlock(block, entry->data, blockLength(block));
+    entry->store_id = id_;
+    entry->block = block;
+  }
+  return entry->data;
+}
+
+char dsl::CompressedTextStore::decodeAt(uint64_t i) const {
+  return cachedBlock(i / kBlockSize)[i % kBlockSize];
+}
+
+void dsl::CompressedTextStore::decode(char* buf, uint64_t pos,
+                                      uint64_t len) const {
+  char tmp[kBlockSize];
+  while (len > 0) {
+    uint64_t block = pos / kBlockSize, off = pos % kBlockSize;
+    uint64_t n = MIN(len, kBlockSize - off);
+    const DecodeCacheEntry *entry = &decode_cache[block % kCacheEntries];
+    if (entry->store_id == id_ && entry->block == block) {
+      memcpy(buf, entry->data + off, n);
+    } else if (off == 0) {
+      decodeBlock(block, buf, n);
+    } else {
+      // Ranges are typically short and scattered, so decode only up to the
+      // end of the range and leave the cache alone.
+      decodeBlock(block, tmp, off + n);
+      memcpy(buf, tmp + off, n);
+    }
+    buf += n;
+    pos += n;
+    len -= n;
+  }
+}
+
+size_t dsl::CompressedTextStore::serialize(std::ostream& out) {
+  size_t out_size = 0;
+
+  out.write(reinterpret_cast<const char *>(&size_), sizeof(uint64_t));
+  out_size += sizeof(uint64_t);
+
+  out.write(reinterpret_cast<const char *>(code_lengths_),
+            sizeof(code_lengths_));
+  out_size += sizeof(code_lengths_);
+
+  uint64_t num_words = bits_.size();
+  out.write(reinterpret_cast<const char *>(&num_words), sizeof(uint64_t));
+  out_size += sizeof(uint64_t);
+
+  out.write(reinterpret_cast<const char *>(bits_.data()),
+            num_words * sizeof(uint64_t));
+  out_size += num_words * sizeof(uint64_t);
+
+  out_size += block_offsets_->serialize(out);
+
+  return out_size;
+}
+
+size_t dsl::CompressedTextStore::deserialize(std::istream& in) {
+  size_t in_size = 0;
+
+  in.read(reinterpret_cast<char *>(&size_), sizeof(uint64_t));
+  in_size += sizeof(uint64_t);
+
+  in.read(reinterpret_cast<char *>(code_lengths_), sizeof(code_lengths_));
+  in_size += sizeof(code_lengths_);
+  buildCodes();
+
+  uint64_t num_words;
+  in.read(reinterpret_cast<char *>(&num_words), sizeof(uint64_t));
+  in_size += sizeof(uint64_t);
+
+  bits_.resize(num_words);
+  in.read(reinterpret_cast<char *>(bits_.data()),
+          num_words * sizeof(uint64_t));
+  in_size += num_words * sizeof(uint64_t);
+
+  delete block_offsets_;
+  block_offsets_ = new BitmapArray();
+  in_size += block_offsets_->deserialize(in);
+
+  // Blocks cached for the previous contents are no longer valid.
+  id_ = next_store_id++;
+
+  return in_size;
+}
@@ -0,0 +1,124 @@
+#include "piecewise_linear_model.h"
+
+#include <algorithm>
+#include <cfloat>
+
+dsl::PiecewiseLinearModel::PiecewiseLinearModel(uint64_t error) {
+  error_ = error;
+  open_ = false;
+  first_key_ = 0;
+  first_pos_ = 0;
+  slope_lo_ = 0;
+  slope_hi_ = DBL_MAX;
+}
+
+void dsl::PiecewiseLinearModel::add(uint64_t key, uint64_t pos) {
+  if (open_) {
+    // Keep the segment open as long as some slope through its first point
+    // predicts every point added so far within the error bound.
+    double dk = (double) (key - first_key_);
+    double lo = ((double) pos - (double) error_ - (double) first_pos_) / dk;
+    double hi = ((double) pos + (double) error_ - (double) first_pos_) / dk;
+    if (lo <= slope_hi_ && hi >= slope_lo_) {
+      slope_lo_ = std::max(slope_lo_, lo);
+      slope_hi_ = std::min(slope_hi_, hi);
+      return;
+    }
+    closeSegment();
+  }
+
+  open_ = true;
+  first_key_ = key;
+  first_pos_ = pos;
+  slope_lo_ = 0;
+  slope_hi_ = DBL_MAX;
+}
+
+void dsl::PiecewiseLinearModel::finish() {
+  if (open_)
+    closeSegment();
+}
+
+void dsl::PiecewiseLinearModel::closeSegment() {
+  keys_.push_back(first_key_);
+  positions_.push_back(first_pos_);
+  slopes_.push_back(slope_hi_ == DBL_MAX ? 0 : (slope_lo_ + slope_hi_) / 2);
+  open_ = false;
+}
+
+int64_t dsl::PiecewiseLinearModel::predict(uint64_t key) const {
+  if (keys_.empty() || key < keys_[0])
+    return 0;
+
+  size_t i = std::upper_bound(keys_.begin(), keys_.end(), key) - keys_.begin()
+      - 1;
+  double pos = (double) positions_[i] + slopes_[i] * (double) (key - keys_[i]);
+
+  // Keys between two segments must not be predicted past the next one.
+  if (i + 1 < keys_.size() && pos > (double) positions_[i + 1])
+    return positions_[i + 1];
+  return (int64_t) pos;
+}
+
+uint64_t dsl::PiecewiseLinearModel::error() const {
+  return error_;
+}
+
+size_t dsl::PiecewiseLinearModel::numSegments() const {
+  return keys_.size();
+}
+
+size_t dsl::PiecewiseLinearModel::serialize(std::ostream& out) {
+  size_t out_size = 0;
+
+  out.write(reinterpret_cast<const char *>(&error_), sizeof(uint64_t));
+  out_size += sizeof(uint64_t);
+
+  uint64_t num_segments = keys_.size();
+  out.write(reinterpret_cast<const char *>(&num_segments), sizeof(uint64_t));
+  out_size += sizeof(uint64_t);
+
+  out.write(reinterpret_cast<const char *>(keys_.data()),
+            num_segments * sizeof(uint64_t));
+  out_size += num_segments * sizeof(uint64_t);
+
+  out.write(reinterpret_cast<const char *>(positions_.data()),
+            num_segments * sizeof(uint64_t));
+  out_size += num_segments * sizeof(uint64_t);
+
+  out.write(reinterpret_cast<const char *>(slopes_.data()),
+            num_segments * sizeof(double));
+  out_size += num_segments * sizeof(double);
+
+  return out_size;
+}
+
+size_t dsl::PiecewiseLinearModel::deserialize(std::istream& in) {
+  size_t in_size = 0;
+
+  in.read(reinterpret_cast<char *>(&error_), sizeof(uint64_t));
+  in_size += sizeof(uint64_t);
+
+  uint64_t num_segments;
+  in.read(reinterpret_cast<char *>(&num_segments), sizeof(uint64_t));
+  in_size += sizeof(uint64_t);
+
+  keys_.resize(num_segments);
+  in.read(reinterpret_cast<char *>(keys_.data()),
+          num_segments * sizeof(uint64_t));
+  in_size += num_segments * sizeof(uint64_t);
+
+  positions_.resize(num_segments);
+  in.read(reinterpret_cast<char *>(positions_.data()),
+          num_segments * sizeof(uint64_t));
+  in_size += num_segments * sizeof(uint64_t);
+
+  slopes_.resize(num_segments);
+  in.read(reinterpret_cast<char *>(slopes_.data()),
+          num_segments * sizeof(double));
+  in_size += num_segments * sizeof(double);
+
+  open_ = false;
+
+  return in_size;
+}
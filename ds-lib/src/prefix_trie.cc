@@ -0,0 +1,201 @@
+#include "prefix_trie.h"
+
+#include <algorithm>
+
+#include "utils.h"
+
+dsl::PrefixTrie::PrefixTrie() {
+  depth_ = 0;
+}
+
+template<typename Visitor>
+void dsl::PrefixTrie::scanSuffixes(const TextStore* text,
+                                   SuffixArray* sa, uint64_t size,
+                                   uint32_t depth, Visitor visit) {
+  std::vector<char> prev(depth), cur(depth);
+  uint32_t prev_len = 0;
+  for (uint64_t i = 0; i < size; i++) {
+    uint64_t pos = sa->at(i);
+    uint32_t n = MIN((uint64_t) depth, size - pos);
+    text->extract(cur.data(), pos, n);
+    uint32_t len = std::find(cur.begin(), cur.begin() + n, '\0')
+        - cur.begin();
+    uint32_t lcp = 0;
+    if (i > 0) {
+      while (lcp < len && lcp < prev_len && cur[lcp] == prev[lcp]) {
+        lcp++;
+      }
+    }
+    visit(i, lcp, len, cur.data());
+    cur.swap(prev);
+    prev_len = len;
+  }
+}
+
+dsl::PrefixTrie::PrefixTrie(const TextStore* text, SuffixArray* sa,
+                            uint64_t size, uint32_t max_depth,
+                            uint64_t max_nodes) {
+  max_nodes = MIN(max_nodes, (uint64_t) UINT32_MAX - 1);
+
+  // A suffix starts a node on every level deeper than what it shares with
+  // the previous suffix, up to its first '\0'. Count them per level to find
+  // how many whole levels fit.
+  std::vector<uint64_t> level_size(max_depth + 2, 0);
+  scanSuffixes(text, sa, size, max_depth,
+               [&](uint64_t, uint32_t lcp, uint32_t len, const char*) {
+    if (len > lcp) {
+      level_size[lcp + 1]++;
+      level_size[len + 1]--;
+    }
+  });
+  depth_ = 0;
+  uint64_t num_nodes = 1;
+  for (uint32_t d = 1; d <= max_depth; d++) {
+    level_size[d] += level_size[d - 1];
+    if (num_nodes + level_size[d] > max_nodes)
+      break;
+    num_nodes += level_size[d];
+    depth_ = d;
+  }
+
+  // Nodes on each level are opened in suffix array order, and closed when a
+  // suffix no longer shares their label.
+  std::vector<std::vector<uint64_t>> level_lb(depth_ + 1);
+  std::vector<std::vector<uint64_t>> level_rb(depth_ + 1);
+  std::vector<std::vector<uint8_t>> level_label(depth_ + 1);
+  uint32_t open_depth = 0;
+  scanSuffixes(text, sa, size, depth_,
+               [&](uint64_t i, uint32_t lcp, uint32_t len,
+                   const char* prefix) {
+    for (uint32_t d = lcp + 1; d <= open_depth; d++) {
+      level_rb[d].push_back(i);
+    }
+    open_depth = MIN(open_depth, lcp);
+    for (uint32_t d = lcp + 1; d <= len; d++) {
+      level_lb[d].push_back(i);
+      level_label[d].push_back(prefix[d - 1]);
+      open_depth = d;
+    }
+  });
+  for (uint32_t d = 1; d <= open_depth; d++) {
+    level_rb[d].push_back(size);
+  }
+
+  lb_.push_back(0);
+  rb_.push_back(size);
+  label_.push_back(0);
+  for (uint32_t d = 1; d <= depth_; d++) {
+    lb_.insert(lb_.end(), level_lb[d].begin(), level_lb[d].end());
+    rb_.insert(rb_.end(), level_rb[d].begin(), level_rb[d].end());
+    label_.insert(label_.end(), level_label[d].begin(), level_label[d].end());
+  }
+
+  // Children of a level's nodes are the next level's nodes within their
+  // range; both levels are sorted, so one merge finds them all.
+  child_begin_.reserve(num_nodes + 1);
+  uint64_t level_begin = 0, level_end = 1;
+  for (uint32_t d = 0; d <= depth_; d++) {
+    uint64_t child = level_end;
+    uint64_t child_end = level_end + (d < depth_ ? level_lb[d + 1].size() : 0);
+    for (uint64_t node = level_begin; node < level_end; node++) {
+      child_begin_.push_back(child);
+      while (child < child_end && lb_[child] < rb_[node]) {
+        child++;
+      }
+    }
+    level_begin = level_end;
+    level_end = child_end;
+  }
+  child_begin_.push_back(num_nodes);
+}
+
+bool dsl::PrefixTrie::find(const std::string& query, uint64_t* lb,
+                           uint64_t* rb, uint32_t* depth) const {
+  uint64_t node = 0;
+  uint32_t d = 0;
+  while (d < depth_ && d < query.length() && query[d] != '\0') {
+    auto begin = label_.begin() + child_begin_[node];
+    auto end = label_.begin() + child_begin_[node + 1];
+    uint8_t c = query[d];
+    auto child = std::lower_bound(begin, end, c);
+    if (child == end || *child != c)
+      return false;
+    node = child - label_.begin();
+    d++;
+  }
+
+  *lb = lb_[node];
+  *rb = rb_[node];
+  *depth = d;
+  return true;
+}
+
+uint32_t dsl::PrefixTrie::depth() const {
+  return depth_;
+}
+
+uint64_t dsl::PrefixTrie::numNodes() const {
+  return lb_.size();
+}
+
+size_t dsl::PrefixTrie::serialize(std::ostream& out) {
+  size_t out_size = 0;
+
+  out.write(reinterpret_cast<const char *>(&depth_), sizeof(uint32_t));
+  out_size += sizeof(uint32_t);
+
+  uint64_t num_nodes = lb_.size();
+  out.write(reinterpret_cast<const char *>(&num_nodes), sizeof(uint64_t));
+  out_size += sizeof(uint64_t);
+
+  out.write(reinterpret_cast<const char *>(child_begin_.data()),
+            (num_nodes + 1) * sizeof(uint32_t));
+  out_size += (num_nodes + 1) * sizeof(uint32_t);
+
+  out.write(reinterpret_cast<const char *>(label_.data()),
+            num_nodes * sizeof(uint8_t));
+  out_size += num_nodes * sizeof(uint8_t);
+
+  out.write(reinterpret_cast<const char *>(lb_.data()),
+            num_nodes * sizeof(uint64_t));
+  out_size += num_nodes * sizeof(uint64_t);
+
+  out.write(reinterpret_cast<const char *>(rb_.data()),
+            num_nodes * sizeof(uint64_t));
+  out_size += num_nodes * sizeof(uint64_t);
+
+  return out_size;
+}
+
+size_t dsl::PrefixTrie::deserialize(std::istream& in) {
+  size_t in_size = 0;
+
+  in.read(reinterpret_cast<char *>(&depth_), sizeof(uint32_t));
+  in_size += sizeof(uint32_t);
+
+  uint64_t num_nodes;
+  in.read(reinterpret_cast<char *>(&num_nodes), sizeof(uint64_t));
+  in_size += sizeof(uint64_t);
+
+  child_begin_.resize(num_nodes + 1);
+  in.read(reinterpret_cast<char *>(child_begin_.data()),
+          (num_nodes + 1) * sizeof(uint32_t));
+  in_size += (num_nodes + 1) * sizeof(uint32_t);
+
+  label_.resize(num_nodes);
+  in.read(reinterpret_cast<char *>(label_.data()),
+          num_nodes * sizeof(uint8_t));
+  in_size += num_nodes * sizeof(uint8_t);
+
+  lb_.resize(num_nodes);
+  in.read(reinterpret_cast<char *>(lb_.data()),
+          num_nodes * sizeof(uint64_t));
+  in_size += num_nodes * sizeof(uint64_t);
+
+  rb_.resize(num_nodes);
+  in.read(reinterpret_cast<char *>(rb_.data()),
+          num_nodes * sizeof(uint64_t));
+  in_size += num_nodes * sizeof(uint64_t);
+
+  return in_size;
+}
@@ -0,0 +1,153 @@
+#include "substring_search.h"
+
+#include <cstring>
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+#include "utils.h"
+
+namespace {
+
+// Each kernel calls visit(pos) for every match in order and stops early once
+// it returns false. Returns false if it was stopped early.
+template<typename Visitor>
+bool scanScalar(const char* text, uint64_t begin, uint64_t end,
+                const char* pattern, size_t len, Visitor& visit) {
+  const char* cur = text + begin;
+  const char* stop = text + end;
+  while (cur < stop) {
+    cur = (const char*) memchr(cur, pattern[0], stop - cur);
+    if (cur == NULL)
+      break;
+    if (memcmp(cur + 1, pattern + 1, len - 1) == 0 && !visit(cur - text))
+      return false;
+    cur++;
+  }
+  return true;
+}
+
+#ifdef __x86_64__
+
+template<typename Visitor>
+bool scanSse2(const char* text, uint64_t size, uint64_t begin, uint64_t end,
+              const char* pattern, size_t len, Visitor& visit) {
+  const __m128i first = _mm_set1_epi8(pattern[0]);
+  const __m128i last = _mm_set1_epi8(pattern[len - 1]);
+
+  uint64_t i = begin;
+  for (; i < end && i + len + 15 <= size; i += 16) {
+    __m128i block_first = _mm_loadu_si128((const __m128i *) (text + i));
+    __m128i block_last = _mm_loadu_si128(
+        (const __m128i *) (text + i + len - 1));
+    uint32_t mask = _mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(first, block_first),
+                      _mm_cmpeq_epi8(last, block_last)));
+    while (mask != 0) {
+      uint64_t pos = i + __builtin_ctz(mask);
+      if (pos >= end)
+        return true;
+      if ((len <= 2 || memcmp(text + pos + 1, pattern + 1, len - 2) == 0)
+          && !visit(pos))
+        return false;
+      mask &= mask - 1;
+    }
+  }
+
+  return i >= end || scanScalar(text, i, end, pattern, len, visit);
+}
+
+template<typename Visitor>
+__attribute__((target("avx2")))
+bool scanAvx2(const char* text, uint64_t size, uint64_t begin, uint64_t end,
+              const char* pattern, size_t len, Visitor& visit) {
+  const __m256i first = _mm256_set1_epi8(pattern[0]);
+  const __m256i last = _mm256_set1_epi8(pattern[len - 1]);
+
+  uint64_t i = begin;
+  for (; i < end && i + len + 31 <= size; i += 32) {
+    __m256i block_first = _mm256_loadu_si256((const __m256i *) (text + i));
+    __m256i block_last = _mm256_loadu_si256(
+        (const __m256i *) (text + i + len - 1));
+    uint32_t mask = _mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(first, block_first),
+                         _mm256_cmpeq_epi8(last, block_last)));
+    while (mask != 0) {
+      uint64_t pos = i + __builtin_ctz(mask);
+      if (pos >= end)
+        return true;
+      if ((len <= 2 || memcmp(text + pos + 1, pattern + 1, len - 2) == 0)
+          && !visit(pos))
+        return false;
+      mask &= mask - 1;
+    }
+  }
+
+  return i >= end || scanScalar(text, i, end, pattern, len, visit);
+}
+
+bool hasAvx2() {
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2;
+}
+
+#endif
+
+template<typename Visitor>
+void scan(const char* text, uint64_t size, uint64_t begin, uint64_t end,
+          const char* pattern, size_t len, Visitor& visit) {
+  if (len == 0 || len > size)
+    return;
+  end = MIN(end, size - len + 1);
+  if (begin >= end)
+    return;
+
+#ifdef __x86_64__
+  if (hasAvx2())
+    scanAvx2(text, size, begin, end, pattern, len, visit);
+  else
+    scanSse2(text, size, begin, end, pattern, len, visit);
+#else
+  scanScalar(text, begin, end, pattern, len, visit);
+#endif
+}
+
+}
+
+void dsl::SubstringSearch::findAll(std::vector<int64_t>& results,
+                                   const char* text, uint64_t size,
+                                   uint64_t begin, uint64_t end,
+                                   const char* pattern, size_t len,
+                                   size_t limit) {
+  size_t found = 0;
+  auto visit = [&](uint64_t pos) {
+    results.push_back(pos);
+    return ++found != limit;
+  };
+  scan(text, size, begin, end, pattern, len, visit);
+}
+
+uint64_t dsl::SubstringSearch::count(const char* text, uint64_t size,
+                                     uint64_t begin, uint64_t end,
+                                     const char* pattern, size_t len) {
+  uint64_t count = 0;
+  auto visit = [&](uint64_t) {
+    count++;
+    return true;
+  };
+  scan(text, size, begin, end, pattern, len, visit);
+  return count;
+}
+
+int64_t dsl::SubstringSearch::findFirst(const char* text, uint64_t size,
+                                        uint64_t begin, uint64_t end,
+                                        const char* pattern, size_t len) {
+  int64_t first = -1;
+  auto visit = [&](uint64_t pos) {
+    first = pos;
+    return false;
+  };
+  scan(text, size, begin, end, pattern, len, visit);
+  return first;
+}
@@ -25,6 +25,27 @@ dsl::SuffixArray::SuffixArray(const char* input_data, size_t input_size)
   delete[] lSA;
 }
 
+dsl::SuffixArray::SuffixArray(const char* input_data, size_t input_size,
+                              const Alphabet& alphabet)
+    : BitmapArray(input_size, Utils::int_log_2(input_size + 1)) {
+
+  uint8_t *codes = new uint8_t[input_size];
+  for (uint64_t i = 0; i < input_size; i++) {
+    codes[i] = alphabet.encode(input_data[i]);
+  }
+
+  int64_t *lSA = new int64_t[input_size];
+  divsufsortxx::constructSA(codes, codes + input_size, lSA, lSA + input_size,
+                            (int) MAX(alphabet.size(), 2));
+  delete[] codes;
+
+  for (uint64_t i = 0; i < num_elements_; i++) {
+    insert(i, lSA[i]);
+  }
+
+  delete[] lSA;
+}
+
 dsl::SuffixArray::SuffixArray(const std::string& input)
     : SuffixArray(input.c_str(), input.length()) {
 }
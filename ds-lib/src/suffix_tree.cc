@@ -1,606 +1,641 @@
 #include "suffix_tree.h"
 
-#include "suffix_array.h"
-
-dsl::SuffixTree::SuffixTree() {
-  input_ = NULL;
-  size_ = 0;
-  root_ = NULL;
-}
-dsl::SuffixTree::SuffixTree(const char* input, size_t size) {
-  input_ = input;
-  size_ = size;
-  construct();
-}
+#include <atomic>
+#include <functional>
+#include <thread>
 
-dsl::SuffixTree::SuffixTree(const std::string& input)
-    : SuffixTree(input.c_str(), input.length() + 1) {
-}
-
-dsl::SuffixTree::~SuffixTree() {
-  deleteTree(root_);
-  delete root_;
-}
+#include "compressed_text_store.h"
+#include "suffix_array.h"
+#include "utils.h"
+
+namespace {
+
+// Runs task(0), ..., task(n - 1), handing tasks out to up to num_threads
+// threads.
+void parallelFor(uint64_t n, uint32_t num_threads,
+                 const std::function<void(uint64_t)>& task) {
+  std::atomic<uint64_t> next(0);
+  auto worker = [&]() {
+    uint64_t i;
+    while ((i = next++) < n) {
+      task(i);
+    }
+  };
 
-void dsl::SuffixTree::deleteTree(st::Node* node) {
-  if (node->is_leaf_) {
-    return;
+  uint64_t num_workers = MIN((uint64_t) num_threads, n);
+  std::vector<std::thread> threads;
+  for (uint64_t i = 1; i < num_workers; i++) {
+    threads.push_back(std::thread(worker));
   }
-
-  for (auto child : ((st::InternalNode *) node)->children_) {
-    deleteTree(child);
-    delete child;
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
   }
 }
 
-void dsl::SuffixTree::construct() {
-
-  // First construct a suffix array and lcp array
-  fprintf(stderr, "Constructing SA...\n");
-  SuffixArray *sa = new SuffixArray(input_, size_);
-  uint32_t N = size_;
-
-  // Populate inverse suffix array
-  fprintf(stderr, "Constructing ISA...\n");
-  uint32_t *isa = new uint32_t[N];
-  for (uint32_t i = 0; i < N; i++) {
-    isa[sa->at(i)] = i;
-  }
-
-  // Populate the LCP array
-  fprintf(stderr, "Constructing LCP...\n");
-  uint64_t *_lcp = new uint64_t[N]();
-  uint32_t lcp_val = 0;
-  uint32_t max_lcp_val = 0;
-  for (uint32_t i = 0; i < N - 1; i++) {
-    uint32_t pos = isa[i];
-    uint32_t j = sa->at(pos - 1);
-    while (i + lcp_val < N - 1 && j + lcp_val < N - 1
-        && input_[i + lcp_val] == input_[j + lcp_val]) {
-      lcp_val++;
-    }
-    _lcp[pos] = lcp_val;
-    if (lcp_val > max_lcp_val)
-      max_lcp_val = lcp_val;
-    if (lcp_val > 0)
-      lcp_val--;
-  }
-  delete[] isa;
-
-  fprintf(stderr, "Deleted ISA...\n");
-
-  BitmapArray *lcp = new BitmapArray(_lcp, N,
-                                     Utils::int_log_2(max_lcp_val + 1));
-  delete[] _lcp;
-
-  // Now we have the LCP array and the Suffix array.
-  // We start constructing the Suffix Tree.
-
-  fprintf(stderr, "Constructing ST...\n");
-  // Initialize the root with the first leaf child
-  root_ = new st::InternalNode();
-
-#ifdef DEBUG_CONSTRUCT
-  fprintf(stderr, "Inserting suffix i=0: (%u, %u)...\n", sa->at(0), N - 1);
-  fprintf(stderr, "Inserting segment (%u, %u) in new leaf.\n", sa->at(0), N - 1);
-#endif
-
-  st::LeafNode *child = new st::LeafNode(sa->at(0));
-  uint32_t last_leaf_id = root_->addChild(sa->at(0), N - 1, child);
-
-  st::LeafNode *last_leaf_node = child;
-  uint32_t last_leaf_depth = N - sa->at(0);
-  for (uint32_t i = 0; i < N - 1; i++) {
-#ifdef DEBUG_CONSTRUCT
-    fprintf(stderr, "Inserting suffix i=%u: (%u, %u)...\n", i + 1, sa->at(i + 1), N - 1);
-#endif
-
-    // Traverse up the right-most path
-    st::InternalNode *current_node = (st::InternalNode *) last_leaf_node
-        ->parent_;
-    uint32_t path_length = last_leaf_depth
-        - current_node->edgeLength(last_leaf_id);
-    while (path_length > lcp->at(i + 1)) {
-      current_node = (st::InternalNode *) current_node->parent_;
-      path_length -= current_node->edgeLength(current_node->leftmostChildId());
-    }
-
-    assert(path_length <= lcp->at(i + 1));
-    assert(!current_node->is_leaf_);
-#ifdef DEBUG_CONSTRUCT
-    fprintf(stderr, "path_length = %u, lcp(i+1) = %u\n", path_length, lcp->at(i + 1));
-#endif
-
-    if (path_length == lcp->at(i + 1)) {
-      st::LeafNode *leaf = new st::LeafNode(sa->at(i + 1));
-#ifdef DEBUG_CONSTRUCT
-      fprintf(stderr, "path_length == lcp(i+1): Inserting segment (%u, %u) in new leaf.\n", sa->at(i + 1) + lcp->at(i + 1), N - 1);
-#endif
-      last_leaf_id = current_node->addChild(sa->at(i + 1) + lcp->at(i + 1),
-                                            N - 1, leaf);
-
-      last_leaf_node = leaf;
-      last_leaf_depth = N - sa->at(i + 1);
-    } else {
-      // Fetch old node info
-      uint32_t old_node_id = current_node->leftmostChildId();
-      st::Node *old_node = current_node->children_[old_node_id];
-      uint32_t old_node_path_length = path_length
-          + current_node->edgeLength(old_node_id);
-
-#ifdef DEBUG_CONSTRUCT
-      assert(path_length < lcp->at(i + 1));
-      uint32_t old_node_start = current_node->start_[old_node_id];
-      uint32_t old_node_end = current_node->end_[old_node_id];
-      fprintf(stderr, "path_length < lcp(i+1): Deleting segment (%u, %u)...\n", old_node_start, old_node_end);
-#endif
-
-      // Delete old node
-      current_node->removeChild(old_node_id);
-
-      // Add new nodes
-      st::InternalNode *new_node = new st::InternalNode();
-
-#ifdef DEBUG_CONSTRUCT
-      fprintf(stderr, "path_length < lcp(i+1): Adding new internal segment (%u, %u)...\n", sa->at(i) + path_length, sa->at(i) + lcp->at(i + 1) - 1);
-#endif
-      current_node->addChild(sa->at(i) + path_length,
-                             sa->at(i) + lcp->at(i + 1) - 1, new_node);
-
-#ifdef DEBUG_CONSTRUCT
-      fprintf(stderr, "path_length < lcp(i+1): Adding back partial old segment (%u, %u)...\n", sa->at(i) + lcp->at(i + 1), sa->at(i) + old_node_path_length - 1);
-#endif
-      new_node->addChild(sa->at(i) + lcp->at(i + 1),
-                         sa->at(i) + old_node_path_length - 1, old_node);
+}
 
-      st::LeafNode *leaf = new st::LeafNode(sa->at(i + 1));
-#ifdef DEBUG_CONSTRUCT
-      fprintf(stderr, "path_length < lcp(i+1): Adding new leaf segment (%u, %u)...\n", sa->at(i + 1) + lcp->at(i + 1), N - 1);
-#endif
-      last_leaf_id = new_node->addChild(sa->at(i + 1) + lcp->at(i + 1), N - 1,
-                                        leaf);
+dsl::CompactSuffixTree* dsl::CompactSuffixTree::create(const char* input,
+                                                       uint64_t size,
+                                                       uint32_t num_threads) {
+  // Leaf ids must stay clear of the 32-bit layout's leaf flag.
+  if (size < (1ULL << 31))
+    return new CompactSuffixTree32(input, size, num_threads);
+  return new CompactSuffixTree64(input, size, num_threads);
+}
 
-      last_leaf_node = leaf;
-      last_leaf_depth = N - sa->at(i + 1);
-    }
-  }
+size_t dsl::CompactSuffixTree::writeTree(std::ostream& out,
+                                         CompactSuffixTree* tree) {
+  size_t out_size = 0;
 
-  fprintf(stderr, "Deleting SA...\n");
-  delete sa;
-  fprintf(stderr, "Deleting LCP...\n");
-  delete lcp;
+  uint8_t width = tree->offsetWidth();
+  out.write(reinterpret_cast<const char *>(&width), sizeof(uint8_t));
+  out_size += sizeof(uint8_t);
 
-#ifdef DEBUG_VERIFY
-  display();
-#endif
+  out_size += tree->serialize(out);
 
+  return out_size;
 }
 
-int32_t dsl::SuffixTree::getChildId(st::InternalNode *node, char c) {
-  // Linear search for now; can replace by binary search
-  for (int32_t i = 0; i < node->start_.size(); i++) {
-#ifdef DEBUG_QUERY
-    fprintf(stderr, "i: %u, path label start: [%c]\n", i, input_[node->start_[i]] == '\0' ? '$' : input_[node->start_[i]]);
-#endif
-    if (input_[node->start_[i]] == c)
-      return i;
+dsl::CompactSuffixTree* dsl::CompactSuffixTree::readTree(std::istream& in,
+                                                         size_t* in_size) {
+  uint8_t width;
+  in.read(reinterpret_cast<char *>(&width), sizeof(uint8_t));
+  *in_size += sizeof(uint8_t);
+
+  CompactSuffixTree *tree;
+  if (width == sizeof(uint32_t)) {
+    tree = new CompactSuffixTree32();
+  } else if (width == sizeof(uint64_t)) {
+    tree = new CompactSuffixTree64();
+  } else {
+    fprintf(stderr, "Unsupported suffix tree offset width %u.\n", width);
+    return NULL;
   }
 
-  return -1;
+  *in_size += tree->deserialize(in);
+  return tree;
 }
 
-dsl::st::InternalNode* dsl::SuffixTree::getRoot() {
-  return root_;
+template<typename offset_t>
+dsl::BasicCompactSuffixTree<offset_t>::BasicCompactSuffixTree() {
+  text_ = NULL;
+  size_ = 0;
+  root_ = 0;
 }
 
-dsl::st::Node* dsl::SuffixTree::walkTree(const std::string& query) {
-  st::InternalNode *current_node = root_;
-  uint32_t pos = 0;
-  while (true) {
-    if (pos == query.length()) {
-      break;
-    }
-
-#ifdef DEBUG_QUERY
-    fprintf(stderr, "At pos = %u\n", pos);
-#endif
-
-    int32_t child_id = getChildId(current_node, query[pos]);
-    uint32_t start_pos = current_node->start_[child_id];
-    uint32_t end_pos = current_node->end_[child_id];
-    current_node = (st::InternalNode*) current_node->children_[child_id];
-
-    if (child_id == -1) {
-#ifdef DEBUG_QUERY
-      fprintf(stderr, "Could not find child node for %c\n", query[pos]);
-#endif
-      return NULL;
-    }
-#ifdef DEBUG_QUERY
-    else {
-      fprintf(stderr, "child_id = %u\n", child_id);
-    }
-    fprintf(stderr, "Found node with start_pos = %u, end_pos = %u\n", start_pos, end_pos);
-#endif
-
-    for (uint32_t i = start_pos; i <= end_pos && pos < query.length(); i++) {
-      if (input_[i] != query[pos]) {
-#ifdef DEBUG_QUERY
-        fprintf(stderr, "Could not match %c with %c, i=%u, pos=%u\n", input_[i], query[pos], i, pos);
-#endif
-        return NULL;
-      }
-      pos++;
-    }
-  }
+template<typename offset_t>
+dsl::BasicCompactSuffixTree<offset_t>::BasicCompactSuffixTree(
+    const char* input, uint64_t size, uint32_t num_threads) {
+  text_ = new PlainTextStore(input, size);
+  size_ = size;
+  if (num_threads == 0)
+    num_threads = MAX(std::thread::hardware_concurrency(), 1);
+  construct(input, num_threads);
+}
 
-  return current_node;
+template<typename offset_t>
+dsl::BasicCompactSuffixTree<offset_t>::~BasicCompactSuffixTree() {
+  delete text_;
 }
 
-void dsl::SuffixTree::getOffsets(std::vector<int64_t> &results,
-                                 st::Node* node) {
+template<typename offset_t>
+uint8_t dsl::BasicCompactSuffixTree<offset_t>::offsetWidth() const {
+  return sizeof(offset_t);
+}
 
-  if (node->is_leaf_) {
-    results.push_back(((st::LeafNode *) node)->offset_);
+template<typename offset_t>
+struct dsl::BasicCompactSuffixTree<offset_t>::Subtrees {
+  struct Child {
+    offset_t id;
+    offset_t offset;
+    offset_t depth;
+  };
+
+  // Laid out as in the tree, with internal nodes and edges numbered from
+  // zero within the part.
+  std::vector<offset_t> child_begin;
+  std::vector<offset_t> edge_start;
+  std::vector<offset_t> edge_end;
+  std::vector<offset_t> edge_child;
+  std::vector<uint8_t> edge_char;
+  std::vector<offset_t> leaf_begin;
+  std::vector<offset_t> leaf_end;
+
+  // Children of the root, in order.
+  std::vector<Child> top;
+};
+
+template<typename offset_t>
+void dsl::BasicCompactSuffixTree<offset_t>::construct(const char* input,
+                                                      uint32_t num_threads) {
+  offset_t N = size_;
+  if (N == 0) {
+    // Just a root, without edges.
+    root_ = 0;
+    child_begin_.assign(2, 0);
+    leaf_begin_.push_back(0);
+    leaf_end_.push_back(0);
+    suffix_link_.push_back(0);
+    table_id_.push_back(0);
     return;
   }
 
-  for (auto child : ((st::InternalNode *) node)->children_) {
-    getOffsets(results, child);
+  fprintf(stderr, "Constructing SA...\n");
+  SuffixArray *sa = new SuffixArray(input, N);
+  leaf_offset_.resize(N);
+  for (offset_t i = 0; i < N; i++) {
+    leaf_offset_[i] = sa->at(i);
   }
-}
+  delete sa;
 
-int64_t dsl::SuffixTree::countLeaves(st::Node *node) {
-  if (node->is_leaf_) {
-    return 1;
-  }
+  // lcp[i] is the length of the longest common prefix of the suffixes at
+  // leaf_offset_[i - 1] and leaf_offset_[i]. Each chunk of text positions
+  // starts its own run of Kasai's algorithm, which is correct from any
+  // starting point.
+  fprintf(stderr, "Constructing LCP...\n");
+  uint64_t num_chunks = num_threads;
+  uint64_t chunk_size = (N + num_chunks - 1) / num_chunks;
+  offset_t *isa = new offset_t[N];
+  parallelFor(num_chunks, num_threads, [&](uint64_t chunk) {
+    offset_t end = MIN(N, (chunk + 1) * chunk_size);
+    for (offset_t i = chunk * chunk_size; i < end; i++) {
+      isa[leaf_offset_[i]] = i;
+    }
+  });
+  offset_t *lcp = new offset_t[N]();
+  parallelFor(num_chunks, num_threads, [&](uint64_t chunk) {
+    offset_t end = MIN(N, (chunk + 1) * chunk_size);
+    offset_t lcp_val = 0;
+    for (offset_t i = chunk * chunk_size; i < end; i++) {
+      offset_t pos = isa[i];
+      if (pos == 0) {
+        lcp_val = 0;
+        continue;
+      }
+      offset_t j = leaf_offset_[pos - 1];
+      while (i + lcp_val < N && j + lcp_val < N
+          && input[i + lcp_val] == input[j + lcp_val]) {
+        lcp_val++;
+      }
+      lcp[pos] = lcp_val;
+      if (lcp_val > 0)
+        lcp_val--;
+    }
+  });
+  delete[] isa;
 
-  int64_t count = 0;
-  for (auto child : ((st::InternalNode *) node)->children_) {
-    count += countLeaves(node);
+  // Only the root spans a zero in the LCP array, so the suffix array splits
+  // there into parts that are built independently. Several parts per thread
+  // even out the uneven sizes of the first-character buckets.
+  fprintf(stderr, "Constructing ST...\n");
+  uint64_t part_size = N / (num_threads == 1 ? 1 : 4 * num_threads);
+  std::vector<offset_t> part_begin;
+  part_begin.push_back(0);
+  for (offset_t i = 1; i < N; i++) {
+    if (lcp[i] == 0 && i - part_begin.back() >= part_size)
+      part_begin.push_back(i);
   }
-
-  return count;
-}
-
-size_t dsl::SuffixTree::writeNode(std::ostream& out, st::Node *node) {
-  size_t out_size = 0;
-
-  out.write(reinterpret_cast<const char *>(&(node->is_leaf_)), sizeof(bool));
-  out_size += sizeof(bool);
-
-  if (node->is_leaf_) {
-    st::LeafNode *lnode = (st::LeafNode *) node;
-    out.write(reinterpret_cast<const char *>(&(lnode->offset_)),
-              sizeof(uint32_t));
-    out_size += sizeof(uint32_t);
-  } else {
-    st::InternalNode *inode = (st::InternalNode *) node;
-    uint8_t node_size = inode->children_.size();
-    out.write(reinterpret_cast<const char *>(&(node_size)),
-              sizeof(uint8_t));
-    out_size += sizeof(uint8_t);
-    for (uint32_t i = 0; i < node_size; i++) {
-      out.write(reinterpret_cast<const char *>(&inode->start_[i]),
-                sizeof(uint32_t));
-      out_size += sizeof(uint32_t);
+  part_begin.push_back(N);
+
+  uint64_t num_parts = part_begin.size() - 1;
+  std::vector<Subtrees> parts(num_parts);
+  parallelFor(num_parts, num_threads, [&](uint64_t i) {
+    buildSubtrees(input, lcp, part_begin[i], part_begin[i + 1] - 1, &parts[i]);
+  });
+  delete[] lcp;
+
+  // Stitch the parts together, numbered in order, and add the root last.
+  std::vector<offset_t> node_base(num_parts + 1, 0);
+  std::vector<offset_t> edge_base(num_parts + 1, 0);
+  for (uint64_t i = 0; i < num_parts; i++) {
+    node_base[i + 1] = node_base[i] + parts[i].child_begin.size();
+    edge_base[i + 1] = edge_base[i] + parts[i].edge_start.size();
+  }
+  root_ = node_base[num_parts];
+  offset_t num_edges = edge_base[num_parts];
+
+  // The first part is already in place.
+  child_begin_.swap(parts[0].child_begin);
+  edge_start_.swap(parts[0].edge_start);
+  edge_end_.swap(parts[0].edge_end);
+  edge_child_.swap(parts[0].edge_child);
+  edge_char_.swap(parts[0].edge_char);
+  leaf_begin_.swap(parts[0].leaf_begin);
+  leaf_end_.swap(parts[0].leaf_end);
+  child_begin_.resize(root_ + 2);
+  leaf_begin_.resize(root_ + 1);
+  leaf_end_.resize(root_ + 1);
+  edge_start_.resize(num_edges);
+  edge_end_.resize(num_edges);
+  edge_child_.resize(num_edges);
+  edge_char_.resize(num_edges);
+  parallelFor(num_parts - 1, num_threads, [&](uint64_t i) {
+    Subtrees& part = parts[i + 1];
+    offset_t nodes = node_base[i + 1], edges = edge_base[i + 1];
+    for (size_t j = 0; j < part.child_begin.size(); j++) {
+      child_begin_[nodes + j] = part.child_begin[j] + edges;
+      leaf_begin_[nodes + j] = part.leaf_begin[j];
+      leaf_end_[nodes + j] = part.leaf_end[j];
     }
-    for (uint32_t i = 0; i < node_size; i++) {
-      out.write(reinterpret_cast<const char *>(&inode->end_[i]),
-                sizeof(uint32_t));
-      out_size += sizeof(uint32_t);
+    for (size_t j = 0; j < part.edge_start.size(); j++) {
+      offset_t child = part.edge_child[j];
+      edge_start_[edges + j] = part.edge_start[j];
+      edge_end_[edges + j] = part.edge_end[j];
+      edge_child_[edges + j] = (child & kLeaf) ? child : child + nodes;
+      edge_char_[edges + j] = part.edge_char[j];
     }
-    for (uint32_t i = 0; i < node_size; i++) {
-      out_size += writeNode(out, inode->children_[i]);
+  });
+
+  child_begin_[root_] = num_edges;
+  leaf_begin_[root_] = 0;
+  leaf_end_[root_] = N;
+  for (uint64_t i = 0; i < num_parts; i++) {
+    for (auto& child : parts[i].top) {
+      edge_start_.push_back(child.offset);
+      edge_end_.push_back(child.offset + child.depth - 1);
+      edge_child_.push_back(
+          (child.id & kLeaf) ? child.id : child.id + node_base[i]);
+      edge_char_.push_back(input[child.offset]);
     }
   }
+  child_begin_[root_ + 1] = edge_start_.size();
+  parts.clear();
 
-  return out_size;
+  buildChildTables();
+  computeSuffixLinks(num_threads);
 }
 
-dsl::st::Node* dsl::SuffixTree::readNode(std::istream& in, size_t *in_size) {
-  bool is_leaf;
-  in.read(reinterpret_cast<char *>(&is_leaf), sizeof(bool));
-  *in_size = (*in_size) + sizeof(bool);
-  st::Node *node;
-  if (is_leaf) {
-    uint32_t offset;
-    in.read(reinterpret_cast<char *>(&offset), sizeof(uint32_t));
-    *in_size = (*in_size) + sizeof(uint32_t);
-    node = new st::LeafNode(offset);
-  } else {
-    node = new st::InternalNode();
-    st::InternalNode *inode = ((st::InternalNode *) node);
-    uint8_t node_size;
-    in.read(reinterpret_cast<char *>(&node_size), sizeof(uint8_t));
-    *in_size = (*in_size) + sizeof(uint8_t);
-    inode->start_.reserve(node_size);
-    for (uint32_t i = 0; i < node_size; i++) {
-      uint32_t val;
-      in.read(reinterpret_cast<char *>(&val), sizeof(uint32_t));
-      *in_size = (*in_size) + sizeof(uint32_t);
-      inode->start_.push_back(val);
+template<typename offset_t>
+void dsl::BasicCompactSuffixTree<offset_t>::buildSubtrees(
+    const char* input, const offset_t* lcp, offset_t lb, offset_t rb,
+    Subtrees* part) const {
+  // Every internal node is an lcp-interval. Intervals are closed in
+  // post-order while scanning the LCP array; children wait on a stack until
+  // their parent closes, and are then written out as its contiguous edges.
+  // A suffix that is a prefix of another sorts first among them and gets a
+  // leaf edge labelled with just the terminator. The root is never closed;
+  // its children are left in part->top.
+  typedef typename Subtrees::Child Child;
+  struct Interval {
+    offset_t depth;
+    offset_t lb;
+    size_t first_child;
+  };
+  offset_t N = size_;
+  std::vector<Interval> open;
+  std::vector<Child>& pending = part->top;
+
+  auto leaf = [&](offset_t i) {
+    // Leaf depths count the terminator.
+    Child child = { i | kLeaf, leaf_offset_[i], N - leaf_offset_[i] + 1 };
+    return child;
+  };
+  auto close = [&](const Interval& node, offset_t last) {
+    offset_t id = part->child_begin.size();
+    part->child_begin.push_back(part->edge_start.size());
+    part->leaf_begin.push_back(node.lb);
+    part->leaf_end.push_back(last + 1);
+    for (size_t i = node.first_child; i < pending.size(); i++) {
+      offset_t start = pending[i].offset + node.depth;
+      part->edge_start.push_back(start);
+      part->edge_end.push_back(pending[i].offset + pending[i].depth - 1);
+      part->edge_child.push_back(pending[i].id);
+      part->edge_char.push_back(start < N ? input[start] : 0);
     }
-    inode->end_.reserve(node_size);
-    for (uint32_t i = 0; i < node_size; i++) {
-      uint32_t val;
-      in.read(reinterpret_cast<char *>(&val), sizeof(uint32_t));
-      *in_size = (*in_size) + sizeof(uint32_t);
-      inode->end_.push_back(val);
+    pending.resize(node.first_child);
+    Child child = { id, leaf_offset_[node.lb], node.depth };
+    return child;
+  };
+
+  Interval root = { 0, lb, 0 };
+  open.push_back(root);
+  pending.push_back(leaf(lb));
+  for (offset_t i = lb + 1; i <= rb + 1; i++) {
+    offset_t l = (i <= rb) ? lcp[i] : 0;
+    offset_t first = i - 1;
+    while (l < open.back().depth) {
+      Interval node = open.back();
+      open.pop_back();
+      pending.push_back(close(node, i - 1));
+      first = node.lb;
     }
-    inode->children_.reserve(node_size);
-    for (uint32_t i = 0; i < node_size; i++) {
-      inode->children_[i] = readNode(in, in_size);
+    if (l > open.back().depth) {
+      Interval node = { l, first, pending.size() - 1 };
+      open.push_back(node);
     }
+    if (i <= rb)
+      pending.push_back(leaf(i));
   }
-
-  return node;
-}
-
-size_t dsl::SuffixTree::serialize(std::ostream& out) {
-  size_t out_size = 0;
-
-  out.write(reinterpret_cast<const char *>(&size_), sizeof(uint32_t));
-  out_size += sizeof(uint32_t);
-
-  out.write(reinterpret_cast<const char *>(input_), size_ * sizeof(char));
-  out_size += size_ * sizeof(char);
-
-  out_size += writeNode(out, root_);
-
-  return out_size;
-}
-
-size_t dsl::SuffixTree::deserialize(std::istream& in) {
-  size_t in_size = 0;
-
-  in.read(reinterpret_cast<char *>(&size_), sizeof(uint32_t));
-  in_size += sizeof(uint32_t);
-
-  char *input = new char[size_];
-  in.read(reinterpret_cast<char *>(input), size_ * sizeof(char));
-  in_size += size_ * sizeof(char);
-  input_ = input;
-
-  root_ = (st::InternalNode *) readNode(in, &in_size);
-
-  return in_size;
 }
 
-dsl::CompactSuffixTree::CompactSuffixTree() {
-  root_ = NULL;
-  input_ = NULL;
-  size_ = 0;
-  num_internal_nodes_ = 0;
-  num_leaf_nodes_ = 0;
+template<typename offset_t>
+void dsl::BasicCompactSuffixTree<offset_t>::buildChildTables() {
+  offset_t num_nodes = child_begin_.size() - 1;
+  table_id_.assign(num_nodes, 0);
+  child_table_.clear();
+  uint32_t num_tables = 0;
+  for (offset_t node = 0; node < num_nodes; node++) {
+    offset_t begin = child_begin_[node], end = child_begin_[node + 1];
+    if (end - begin < kTableFanout || num_tables == kMaxTables)
+      continue;
+
+    child_table_.resize((num_tables + 1) * 256, 0);
+    uint16_t *table = &child_table_[num_tables * 256];
+    for (offset_t e = begin; e < end; e++) {
+      if (edge_start_[e] != size_)
+        table[edge_char_[e]] = e - begin + 1;
+    }
+    table_id_[node] = ++num_tables;
+  }
 }
 
-dsl::CompactSuffixTree::CompactSuffixTree(const char* input, uint32_t size) {
-  input_ = input;
-  size_ = size;
-  num_internal_nodes_ = 0;
-  num_leaf_nodes_ = 0;
-  SuffixTree *st = new SuffixTree(input, size);
-  fprintf(stderr, "Compacting Suffix Tree...\n");
-  root_ = new st::CompactInternalNode(st->getRoot());
-  fprintf(stderr, "Deleting Original Suffix Tree...\n");
-  delete st;
-}
+template<typename offset_t>
+void dsl::BasicCompactSuffixTree<offset_t>::computeSuffixLinks(
+    uint32_t num_threads) {
+  // The link of a node lies below the link of its parent, so nodes are
+  // visited top-down and each search resumes from the parent's link. The
+  // path to the link is known to exist, so only the first character of each
+  // edge on the way down is compared. Subtrees of the root only read each
+  // other's structure, so they are linked concurrently.
+  suffix_link_.assign(child_begin_.size() - 1, root_);
+  struct Visit {
+    offset_t parent;
+    offset_t parent_depth;
+    offset_t edge;
+  };
+  offset_t first_edge = child_begin_[root_];
+  uint64_t num_edges = child_begin_[root_ + 1] - first_edge;
+  parallelFor(num_edges, num_threads, [&](uint64_t i) {
+    std::vector<Visit> stack;
+    Visit top = { root_, 0, (offset_t) (first_edge + i) };
+    stack.push_back(top);
+    while (!stack.empty()) {
+      Visit visit = stack.back();
+      stack.pop_back();
+      offset_t e = visit.edge;
+      offset_t child = edge_child_[e];
+      if (child & kLeaf)
+        continue;
+
+      offset_t depth = visit.parent_depth + edge_end_[e] - edge_start_[e] + 1;
+      offset_t label = leaf_offset_[leaf_begin_[child]] + 1;
+      offset_t link = suffix_link_[visit.parent];
+      offset_t link_depth = (visit.parent == root_) ? 0
+          : visit.parent_depth - 1;
+      while (link_depth < depth - 1) {
+        int64_t edge = getChildEdge(link, text_->charAt(label + link_depth));
+        link_depth += edge_end_[edge] - edge_start_[edge] + 1;
+        link = edge_child_[edge];
+      }
+      suffix_link_[child] = link;
 
-dsl::CompactSuffixTree::CompactSuffixTree(const std::string& input)
-    : CompactSuffixTree(input.c_str(), input.length()) {
+      for (offset_t c = child_begin_[child]; c < child_begin_[child + 1];
+          c++) {
+        Visit next = { child, depth, c };
+        stack.push_back(next);
+      }
+    }
+  });
 }
 
-dsl::CompactSuffixTree::~CompactSuffixTree() {
-  deleteTree(root_);
-  delete root_;
+template<typename offset_t>
+dsl::st::NodeId dsl::BasicCompactSuffixTree<offset_t>::toNodeId(
+    offset_t node) const {
+  return (node & kLeaf) ? (node & ~kLeaf) | st::kLeafFlag : node;
 }
 
-void dsl::CompactSuffixTree::deleteTree(st::CompactNode *node) {
-  if (node->is_leaf_) {
-    return;
+template<typename offset_t>
+int64_t dsl::BasicCompactSuffixTree<offset_t>::getChildEdge(offset_t node,
+                                                            char c) const {
+  int64_t low = child_begin_[node];
+  int64_t high = (int64_t) child_begin_[node + 1] - 1;
+  if (table_id_[node] != 0) {
+    uint16_t entry = child_table_[(table_id_[node] - 1) * 256 + (uint8_t) c];
+    return entry == 0 ? -1 : low + entry - 1;
   }
 
-  st::CompactInternalNode *internal_node = (st::CompactInternalNode *) node;
-  for (uint32_t i = 0; i < internal_node->size_; i++) {
-    st::CompactNode* child = internal_node->children_[i];
-    delete child;
-  }
-}
+  // The terminator edge, if any, comes first and matches no character.
+  if (low <= high && edge_start_[low] == size_)
+    low++;
 
-int32_t dsl::CompactSuffixTree::getChildId(st::CompactInternalNode *node,
-                                           char c) {
   // Binary search for character
-  int32_t low = 0, high = node->size_ - 1, mid_point = 0;
-  while(low <= high) {
-    mid_point = low + (high - low) / 2;
-    if(c == input_[node->start_[mid_point]]) {
-      return mid_point;
-    } else if(c < input_[node->start_[mid_point]]) {
-      high = mid_point - 1;
+  uint8_t key = c;
+  while (low <= high) {
+    int64_t mid = low + (high - low) / 2;
+    if (key == edge_char_[mid]) {
+      return mid;
+    } else if (key < edge_char_[mid]) {
+      high = mid - 1;
     } else {
-      low = mid_point + 1;
+      low = mid + 1;
     }
   }
 
   return -1;
 }
 
-dsl::st::CompactNode* dsl::CompactSuffixTree::walkTree(
-    const std::string& query) {
-  st::CompactInternalNode *current_node = root_;
-  uint32_t pos = 0;
-  while (true) {
-    if (pos == query.length()) {
-      break;
-    }
-
-#ifdef DEBUG_QUERY
-    fprintf(stderr, "At pos = %u\n", pos);
-#endif
-
-    int32_t child_id = getChildId(current_node, query[pos]);
-    uint32_t start_pos = current_node->start_[child_id];
-    uint32_t end_pos = current_node->end_[child_id];
-    current_node = (st::CompactInternalNode*) current_node->children_[child_id];
-
-    if (child_id == -1) {
+template<typename offset_t>
+dsl::st::NodeId dsl::BasicCompactSuffixTree<offset_t>::walkTree(
+    const std::string& query) const {
+  offset_t node = root_;
+  uint64_t pos = 0;
+  while (pos < query.length()) {
+    if (node & kLeaf)
+      return st::kNoNode;
+
+    int64_t edge = getChildEdge(node, query[pos]);
+    if (edge == -1) {
 #ifdef DEBUG_QUERY
       fprintf(stderr, "Could not find child node for %c\n", query[pos]);
 #endif
-      return NULL;
-    }
-#ifdef DEBUG_QUERY
-    else {
-      fprintf(stderr, "child_id = %u\n", child_id);
+      return st::kNoNode;
     }
-    fprintf(stderr, "Found node with start_pos = %u, end_pos = %u\n", start_pos, end_pos);
-#endif
 
-    for (uint32_t i = start_pos; i <= end_pos && pos < query.length(); i++) {
-      if (input_[i] != query[pos]) {
-#ifdef DEBUG_QUERY
-        fprintf(stderr, "Could not match %c with %c, i=%u, pos=%u\n", input_[i], query[pos], i, pos);
-#endif
-        return NULL;
-      }
-      pos++;
+    // The first character was matched when choosing the edge.
+    pos++;
+    for (uint64_t i = edge_start_[edge] + 1;
+        i <= edge_end_[edge] && pos < query.length(); i++, pos++) {
+      if (i == size_ || text_->charAt(i) != query[pos])
+        return st::kNoNode;
     }
+    node = edge_child_[edge];
   }
 
-  return current_node;
+  return toNodeId(node);
 }
 
-void dsl::CompactSuffixTree::getOffsets(std::vector<int64_t>& results,
-                                        st::CompactNode* node) {
-  if (node->is_leaf_) {
-#ifdef DEBUG_QUERY
-    fprintf(stderr, "Hit a leaf node with offset %u\n", ((st::CompactLeafNode *) node)->offset_);
-#endif
-    results.push_back(((st::CompactLeafNode *) node)->offset_);
+template<typename offset_t>
+void dsl::BasicCompactSuffixTree<offset_t>::getOffsets(
+    std::vector<int64_t>& results, st::NodeId node) const {
+  if (node & st::kLeafFlag) {
+    results.push_back(leaf_offset_[node & ~st::kLeafFlag]);
     return;
   }
 
-  st::CompactInternalNode *internal_node = ((st::CompactInternalNode *) node);
-  for (uint32_t i = 0; i < internal_node->size_; i++) {
-    st::CompactNode* child = internal_node->children_[i];
-    getOffsets(results, child);
-  }
+  results.insert(results.end(), leaf_offset_.begin() + leaf_begin_[node],
+                 leaf_offset_.begin() + leaf_end_[node]);
 }
 
-int64_t dsl::CompactSuffixTree::countLeaves(st::CompactNode* node) {
-  if (node->is_leaf_) {
+template<typename offset_t>
+int64_t dsl::BasicCompactSuffixTree<offset_t>::countLeaves(
+    st::NodeId node) const {
+  if (node & st::kLeafFlag) {
     return 1;
   }
 
-  int64_t count = 0;
-  st::CompactInternalNode *internal_node = ((st::CompactInternalNode *) node);
-  for (uint32_t i = 0; i < internal_node->size_; i++) {
-    st::CompactNode* child = internal_node->children_[i];
-    count += countLeaves(child);
+  return leaf_end_[node] - leaf_begin_[node];
+}
+
+template<typename offset_t>
+void dsl::BasicCompactSuffixTree<offset_t>::matchingStatistics(
+    std::vector<int64_t>& lengths, const std::string& pattern) const {
+  uint64_t m = pattern.length();
+  lengths.resize(m);
+
+  // The match so far ends matched characters below the root, on edge below
+  // node unless matched == depth; node is at string depth depth.
+  offset_t node = root_;
+  uint64_t depth = 0, matched = 0;
+  int64_t edge = -1;
+  for (uint64_t i = 0; i < m; i++) {
+    while (i + matched < m) {
+      if (matched == depth) {
+        edge = getChildEdge(node, pattern[i + matched]);
+        if (edge == -1)
+          break;
+      }
+      uint64_t pos = edge_start_[edge] + matched - depth;
+      if (pos == size_ || text_->charAt(pos) != pattern[i + matched])
+        break;
+      matched++;
+      // Only edges into internal nodes end before the terminator.
+      if (pos == edge_end_[edge]) {
+        node = edge_child_[edge];
+        depth = matched;
+      }
+    }
+    lengths[i] = matched;
+
+    if (matched == 0)
+      continue;
+
+    // Drop the first character and find the new position again, skipping
+    // whole edges since the characters are known to occur.
+    if (node != root_) {
+      node = suffix_link_[node];
+      depth--;
+    }
+    matched--;
+    while (matched > depth) {
+      edge = getChildEdge(node, pattern[i + 1 + depth]);
+      uint64_t length = edge_end_[edge] - edge_start_[edge] + 1;
+      if (depth + length > matched)
+        break;
+      node = edge_child_[edge];
+      depth += length;
+    }
   }
+}
 
-  return count;
+template<typename offset_t>
+char dsl::BasicCompactSuffixTree<offset_t>::charAt(uint64_t i) const {
+  return text_->charAt(i);
 }
 
-char dsl::CompactSuffixTree::charAt(uint64_t i) const {
-  return input_[i];
+template<typename offset_t>
+void dsl::BasicCompactSuffixTree<offset_t>::compressText() {
+  // An empty text has nothing to compress.
+  if (text_->type() == TextStore::kCompressed || size_ == 0)
+    return;
+  TextStore *text = new CompressedTextStore(text_->data(), size_);
+  delete text_;
+  text_ = text;
 }
 
-size_t dsl::CompactSuffixTree::writeNode(std::ostream& out,
-                                         st::CompactNode *node) {
+template<typename offset_t>
+template<typename T>
+size_t dsl::BasicCompactSuffixTree<offset_t>::writeArray(
+    std::ostream& out, const std::vector<T>& array) {
   size_t out_size = 0;
 
-  out.write(reinterpret_cast<const char *>(&(node->is_leaf_)), sizeof(bool));
-  out_size += sizeof(bool);
+  uint64_t num_elements = array.size();
+  out.write(reinterpret_cast<const char *>(&num_elements), sizeof(uint64_t));
+  out_size += sizeof(uint64_t);
 
-  if (node->is_leaf_) {
-    st::CompactLeafNode *lnode = (st::CompactLeafNode *) node;
-    out.write(reinterpret_cast<const char *>(&(lnode->offset_)),
-              sizeof(uint32_t));
-    out_size += sizeof(uint32_t);
-  } else {
-    st::CompactInternalNode *inode = (st::CompactInternalNode *) node;
-    out.write(reinterpret_cast<const char *>(&(inode->size_)), sizeof(uint8_t));
-    out_size += sizeof(uint8_t);
-    for (uint32_t i = 0; i < inode->size_; i++) {
-      out.write(reinterpret_cast<const char *>(&inode->start_[i]),
-                sizeof(uint32_t));
-      out_size += sizeof(uint32_t);
-    }
-    for (uint32_t i = 0; i < inode->size_; i++) {
-      out.write(reinterpret_cast<const char *>(&inode->end_[i]),
-                sizeof(uint32_t));
-      out_size += sizeof(uint32_t);
-    }
-    for (uint32_t i = 0; i < inode->size_; i++) {
-      out_size += writeNode(out, inode->children_[i]);
-    }
-  }
+  out.write(reinterpret_cast<const char *>(array.data()),
+            num_elements * sizeof(T));
+  out_size += num_elements * sizeof(T);
 
   return out_size;
 }
 
-dsl::st::CompactNode* dsl::CompactSuffixTree::readNode(std::istream& in,
-                                                       size_t *in_size) {
-  bool is_leaf;
-  in.read(reinterpret_cast<char *>(&is_leaf), sizeof(bool));
-  *in_size = (*in_size) + sizeof(bool);
-  if (is_leaf) {
-    uint32_t offset;
-    in.read(reinterpret_cast<char *>(&offset), sizeof(uint32_t));
-    *in_size = (*in_size) + sizeof(uint32_t);
-    num_leaf_nodes_++;
-    return new st::CompactLeafNode(offset);
-  } else {
-    num_internal_nodes_++;
-    st::CompactInternalNode *inode = new st::CompactInternalNode();
-    in.read(reinterpret_cast<char *>(&inode->size_), sizeof(uint8_t));
-    *in_size = (*in_size) + sizeof(uint8_t);
-    inode->start_ = new uint32_t[inode->size_];
-    for (uint32_t i = 0; i < inode->size_; i++) {
-      in.read(reinterpret_cast<char *>(&inode->start_[i]), sizeof(uint32_t));
-      *in_size = (*in_size) + sizeof(uint32_t);
-    }
-    inode->end_ = new uint32_t[inode->size_];
-    for (uint32_t i = 0; i < inode->size_; i++) {
-      in.read(reinterpret_cast<char *>(&inode->end_[i]), sizeof(uint32_t));
-      *in_size = (*in_size) + sizeof(uint32_t);
-    }
-    inode->children_ = new st::CompactNode*[inode->size_]();
-    for (uint32_t i = 0; i < inode->size_; i++) {
-      inode->children_[i] = readNode(in, in_size);
-    }
-    return inode;
-  }
+template<typename offset_t>
+template<typename T>
+size_t dsl::BasicCompactSuffixTree<offset_t>::readArray(
+    std::istream& in, std::vector<T>& array) {
+  size_t in_size = 0;
+
+  uint64_t num_elements;
+  in.read(reinterpret_cast<char *>(&num_elements), sizeof(uint64_t));
+  in_size += sizeof(uint64_t);
+
+  array.resize(num_elements);
+  in.read(reinterpret_cast<char *>(array.data()), num_elements * sizeof(T));
+  in_size += num_elements * sizeof(T);
+
+  return in_size;
 }
 
-size_t dsl::CompactSuffixTree::serialize(std::ostream& out) {
+template<typename offset_t>
+size_t dsl::BasicCompactSuffixTree<offset_t>::serialize(std::ostream& out) {
   size_t out_size = 0;
 
-  out.write(reinterpret_cast<const char *>(&size_), sizeof(uint32_t));
-  out_size += sizeof(uint32_t);
+  out_size += TextStore::writeStore(out, text_);
 
-  out.write(reinterpret_cast<const char *>(input_), size_ * sizeof(char));
-  out_size += size_ * sizeof(char);
+  out.write(reinterpret_cast<const char *>(&root_), sizeof(offset_t));
+  out_size += sizeof(offset_t);
 
-  out_size += writeNode(out, root_);
+  // The arrays are written as they are held in memory, one block each.
+  out_size += writeArray(out, child_begin_);
+  out_size += writeArray(out, edge_start_);
+  out_size += writeArray(out, edge_end_);
+  out_size += writeArray(out, edge_child_);
+  out_size += writeArray(out, edge_char_);
+  out_size += writeArray(out, leaf_offset_);
+  out_size += writeArray(out, leaf_begin_);
+  out_size += writeArray(out, leaf_end_);
+  out_size += writeArray(out, suffix_link_);
+  out_size += writeArray(out, table_id_);
+  out_size += writeArray(out, child_table_);
 
   return out_size;
 }
 
-size_t dsl::CompactSuffixTree::deserialize(std::istream& in) {
+template<typename offset_t>
+size_t dsl::BasicCompactSuffixTree<offset_t>::deserialize(std::istream& in) {
   size_t in_size = 0;
 
-  in.read(reinterpret_cast<char *>(&size_), sizeof(uint32_t));
-  in_size += sizeof(uint32_t);
+  text_ = TextStore::readStore(in, &in_size);
+  size_ = text_->size();
 
-  char *input = new char[size_];
-  in.read(reinterpret_cast<char *>(input), size_ * sizeof(char));
-  in_size += size_ * sizeof(char);
-  input_ = input;
+  in.read(reinterpret_cast<char *>(&root_), sizeof(offset_t));
+  in_size += sizeof(offset_t);
 
-  root_ = (st::CompactInternalNode *) readNode(in, &in_size);
+  in_size += readArray(in, child_begin_);
+  in_size += readArray(in, edge_start_);
+  in_size += readArray(in, edge_end_);
+  in_size += readArray(in, edge_child_);
+  in_size += readArray(in, edge_char_);
+  in_size += readArray(in, leaf_offset_);
+  in_size += readArray(in, leaf_begin_);
+  in_size += readArray(in, leaf_end_);
+  in_size += readArray(in, suffix_link_);
+  in_size += readArray(in, table_id_);
+  in_size += readArray(in, child_table_);
 
   return in_size;
 }
+
+template class dsl::BasicCompactSuffixTree<uint32_t>;
+template class dsl::BasicCompactSuffixTree<uint64_t>;
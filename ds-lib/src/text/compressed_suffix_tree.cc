@@ -1,63 +1,115 @@
 #include "text/compressed_suffix_tree.h"
 
+#include <atomic>
+
+namespace {
+
+struct ExtractCursor {
+  uint64_t tree_id;
+  uint64_t begin;
+  uint64_t length;
+  uchar data[dsl::CompressedSuffixTree::kExtractBlockSize];
+};
+
+// A tree id of 0 marks an empty cursor.
+thread_local ExtractCursor extract_cursor;
+
+std::atomic<uint64_t> next_tree_id(1);
+
+}
+
 dsl::CompressedSuffixTree::CompressedSuffixTree() {
   cst_ = NULL;
+  id_ = next_tree_id++;
 }
 
 dsl::CompressedSuffixTree::CompressedSuffixTree(const std::string& input,
-                                                const std::string& input_path,
-                                                bool construct) {
-
+                                                uint32_t sample_rate) {
   uint8_t* data = (uint8_t*) input.c_str();
   uint64_t size = input.length() + 1;
+  alphabet_ = Alphabet(input.c_str(), size);
+  cst_ = new SSTree(data, size, false, sample_rate);
+  id_ = next_tree_id++;
+}
 
-  if (construct) {
-    cst_ = new SSTree(data, size, false, 0, SSTree::io_action::save_to,
-                      input_path.c_str());
-  } else {
-    cst_ = new SSTree(data, size, false, 0, SSTree::io_action::load_from,
-                      input_path.c_str());
-  }
+dsl::CompressedSuffixTree::~CompressedSuffixTree() {
+  delete cst_;
+}
+
+bool dsl::CompressedSuffixTree::getRange(const std::string& query,
+                                         uint64_t* sp, uint64_t* ep) const {
+  if (query.empty())
+    return false;
+  ulong l, r;
+  if (!cst_->sa->Search((uchar *) query.c_str(), query.length(), &l, &r))
+    return false;
+  *sp = l;
+  *ep = r;
+  return true;
 }
 
 void dsl::CompressedSuffixTree::search(std::vector<int64_t>& results,
                                        const std::string& query) const {
-  uint64_t node = cst_->search((unsigned char *) query.c_str(), query.length());
-  if (node == 0) {
+  uint64_t sp, ep;
+  if (!getRange(query, &sp, &ep))
     return;
-  }
-  uint64_t leftmost_leaf = cst_->leftmost(node);
-  uint64_t sa_idx = cst_->leftrank(leftmost_leaf);
-  uint64_t count = cst_->numberofleaves(node);
-  results.reserve(count);
-  for (uint64_t i = 0; i < count; i++) {
-    results.push_back(cst_->sa->lookup(sa_idx + i));
-  }
+  size_t base = results.size();
+  results.resize(base + ep - sp + 1);
+  static_assert(sizeof(ulong) == sizeof(int64_t), "ulong must be 64 bits");
+  cst_->sa->lookup(sp, ep, reinterpret_cast<ulong *>(results.data() + base));
 }
 
 int64_t dsl::CompressedSuffixTree::count(const std::string& query) const {
-  uint64_t node = cst_->search((unsigned char *) query.c_str(), query.length());
-  return node == 0 ? 0 : cst_->numberofleaves(node);
+  uint64_t sp, ep;
+  return getRange(query, &sp, &ep) ? ep - sp + 1 : 0;
 }
 
 bool dsl::CompressedSuffixTree::contains(const std::string& query) const {
-  return cst_->search((unsigned char *) query.c_str(), query.length()) != 0;
+  uint64_t sp, ep;
+  return getRange(query, &sp, &ep);
 }
 
 char dsl::CompressedSuffixTree::charAt(uint64_t i) const {
-  return cst_->substring(i, 1)[0];
+  ExtractCursor *cursor = &extract_cursor;
+  bool same_tree = cursor->tree_id == id_;
+  if (same_tree && i - cursor->begin < cursor->length)
+    return cursor->data[i - cursor->begin];
+
+  // A block costs one LF step per character on top of the walk from the
+  // nearest sample, which a lone read would waste; only a read right after
+  // the cursor, as in a forward scan, decodes a block from i on.
+  bool forward = same_tree && i == cursor->begin + cursor->length;
+  cursor->begin = i;
+  cursor->length = cst_->substring(i, forward ? kExtractBlockSize : 1,
+                                   cursor->data);
+  cursor->tree_id = id_;
+  return cursor->length > 0 ? cursor->data[0] : '\0';
+}
+
+uint64_t dsl::CompressedSuffixTree::extract(char* buf, uint64_t pos,
+                                            uint64_t len) const {
+  return cst_->substring(pos, len, (uchar *) buf);
 }
 
 size_t dsl::CompressedSuffixTree::serialize(std::ostream& out) {
-  // Doesn't support manual serialization
-  fprintf(stderr, "Manual serialization not supported.");
-  fprintf(stderr, "Set construct flag to true in the constructor.");
-  return 0;
+  size_t out_size = 0;
+
+  out_size += alphabet_.serialize(out);
+  out_size += cst_->Save(out);
+
+  return out_size;
 }
 
 size_t dsl::CompressedSuffixTree::deserialize(std::istream& in) {
-  // Doesn't support manual deserialization
-  fprintf(stderr, "Manual serialization not supported.");
-  fprintf(stderr, "Set construct flag to false in the constructor.");
-  return 0;
+  size_t in_size = 0;
+
+  in_size += alphabet_.deserialize(in);
+
+  ulong cst_size = 0;
+  delete cst_;
+  cst_ = new SSTree(in, &cst_size);
+  id_ = next_tree_id++;
+  in_size += cst_size;
+
+  return in_size;
 }
@@ -0,0 +1,365 @@
+#include "text/multigram_index.h"
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+#include "compressed_text_store.h"
+#include "utils.h"
+
+dsl::MultiGramIndex::MultiGramIndex() {
+  text_ = NULL;
+  size_ = 0;
+  max_postings_ = 0;
+  max_len_ = 0;
+  bits_ = 0;
+  postings_ = NULL;
+}
+
+dsl::MultiGramIndex::MultiGramIndex(const char *input, size_t size,
+                                    uint64_t max_postings) {
+  text_ = new PlainTextStore(input, size);
+  size_ = size;
+  max_postings_ = max_postings;
+  postings_ = NULL;
+  constructMultiGramIndex(input);
+}
+
+dsl::MultiGramIndex::MultiGramIndex(const std::string& input,
+                                    uint64_t max_postings)
+    : MultiGramIndex(input.c_str(), input.length(), max_postings) {
+}
+
+dsl::MultiGramIndex::~MultiGramIndex() {
+  delete text_;
+  delete postings_;
+}
+
+void dsl::MultiGramIndex::constructMultiGramIndex(const char* input) {
+  alphabet_ = Alphabet(input, size_);
+  bits_ = Utils::int_log_2(alphabet_.size() + 1);
+  max_len_ = 64 / bits_;
+
+  // Level len extends the grams of the offsets still active by their len-th
+  // symbol and counts them. Grams that are rare enough, or cannot grow any
+  // longer, get a slice of the postings for their offsets, which leave; the
+  // others stay for the next level. Offsets stay in text order throughout,
+  // and so does every slice.
+  std::vector<uint64_t> active(size_), active_keys(size_, 0);
+  std::iota(active.begin(), active.end(), 0);
+  std::vector<uint64_t> level_keys;
+  std::vector<uint64_t> offsets(1, 0);
+  std::vector<uint64_t> postings(size_);
+  std::unordered_map<uint64_t, uint64_t> slot;
+  for (uint32_t len = 1; len <= max_len_ && !active.empty(); len++) {
+    uint32_t shift = 64 - len * bits_;
+    slot.clear();
+    size_t num_active = 0;
+    for (size_t j = 0; j < active.size(); j++) {
+      uint64_t i = active[j];
+      // Offsets this close to the end are only found by checking the text
+      if (i + len > size_)
+        continue;
+      uint64_t code = alphabet_.encode(input[i + len - 1]) + 1;
+      active[num_active] = i;
+      active_keys[num_active] = active_keys[j] | (code << shift);
+      slot[active_keys[num_active++]]++;
+    }
+
+    for (auto& entry : slot) {
+      if (entry.second <= max_postings_ || len == max_len_) {
+        level_keys.push_back(entry.first);
+        uint64_t count = entry.second;
+        entry.second = offsets.back();
+        offsets.push_back(offsets.back() + count);
+      } else {
+        entry.second = UINT64_MAX;
+      }
+    }
+
+    size_t num_kept = 0;
+    for (size_t j = 0; j < num_active; j++) {
+      uint64_t& next = slot[active_keys[j]];
+      if (next == UINT64_MAX) {
+        active[num_kept] = active[j];
+        active_keys[num_kept++] = active_keys[j];
+      } else {
+        postings[next++] = active[j];
+      }
+    }
+    active.resize(num_kept);
+    active_keys.resize(num_kept);
+  }
+
+  // Slices were handed out level by level; put them in key order.
+  std::vector<uint64_t> order(level_keys.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](uint64_t a, uint64_t b) {
+    return level_keys[a] < level_keys[b];
+  });
+  keys_.clear();
+  std::vector<uint64_t> sorted_offsets(1, 0);
+  std::vector<uint64_t> sorted(offsets.back());
+  for (auto k : order) {
+    keys_.push_back(level_keys[k]);
+    std::copy(postings.begin() + offsets[k], postings.begin() + offsets[k + 1],
+              sorted.begin() + sorted_offsets.back());
+    sorted_offsets.push_back(sorted_offsets.back() + offsets[k + 1]
+                             - offsets[k]);
+  }
+
+  delete postings_;
+  postings_ = new CompressedPostings(sorted.data(), sorted_offsets);
+
+#ifdef DEBUG_CONSTRUCT
+  for (size_t k = 0; k < keys_.size(); k++) {
+    fprintf(stderr, "[%llx]: %llu\n", keys_[k], postings_->size(k));
+  }
+#endif
+}
+
+uint64_t dsl::MultiGramIndex::encode(const char* str, uint32_t len) const {
+  uint64_t key = 0;
+  for (uint32_t i = 0; i < len; i++) {
+    uint64_t code = alphabet_.encode(str[i]) + 1;
+    key |= code << (64 - (i + 1) * bits_);
+  }
+  return key;
+}
+
+uint32_t dsl::MultiGramIndex::gramLength(uint64_t key) const {
+  return (64 - __builtin_ctzll(key) + bits_ - 1) / bits_;
+}
+
+uint64_t dsl::MultiGramIndex::prefixMask(uint32_t len) const {
+  return len == 0 ? 0 : ~0ULL << (64 - len * bits_);
+}
+
+void dsl::MultiGramIndex::decodeSpan(const Span& span,
+                                     std::vector<uint64_t>& out,
+                                     bool sorted) const {
+  out.resize(postings_->offset(span.last) - postings_->offset(span.first));
+  uint64_t *p = out.data();
+  for (uint64_t list = span.first; list < span.last; list++) {
+    postings_->decode(list, p);
+    p += postings_->size(list);
+  }
+  if (sorted && span.last - span.first > 1)
+    std::sort(out.begin(), out.end());
+
+  if (span.begin == 0)
+    return;
+  size_t num_out = 0;
+  for (auto offset : out) {
+    if (offset >= span.begin)
+      out[num_out++] = offset - span.begin;
+  }
+  out.resize(num_out);
+}
+
+void dsl::MultiGramIndex::locate(const std::string& query,
+                                 std::vector<uint64_t>& results) const {
+  uint64_t query_len = query.length();
+
+  // Every offset of the query starts either an indexed gram, which is the
+  // only one that can be a prefix of the query there, or, near the end of
+  // the query, a prefix of the indexed grams in a range of keys. If some
+  // offset starts neither, the query only occurs where the text is too
+  // short for a gram.
+  std::vector<Span> spans;
+  for (uint64_t i = 0; i < query_len; i++) {
+    uint32_t len = MIN(query_len - i, (uint64_t) max_len_);
+    uint64_t key = encode(query.c_str() + i, len);
+    Span span = { i, query_len, 0, 0 };
+    auto it = std::upper_bound(keys_.begin(), keys_.end(), key);
+    if (it != keys_.begin()
+        && (key & prefixMask(gramLength(*(it - 1)))) == *(it - 1)) {
+      span.end = i + gramLength(*(it - 1));
+      span.first = it - 1 - keys_.begin();
+      span.last = span.first + 1;
+    } else if (i + len == query_len) {
+      span.first = std::lower_bound(keys_.begin(), keys_.end(), key)
+          - keys_.begin();
+      span.last = std::upper_bound(keys_.begin(), keys_.end(),
+                                   key | ~prefixMask(len)) - keys_.begin();
+    }
+    if (span.first == span.last) {
+      spans.clear();
+      break;
+    }
+    spans.push_back(span);
+  }
+
+  if (!spans.empty()) {
+    auto span_size = [&](size_t s) {
+      return postings_->offset(spans[s].last)
+          - postings_->offset(spans[s].first);
+    };
+
+    // Picks the spans that cover the query with the fewest postings in
+    // total; cost[c] is that total for the first c characters, and from[c]
+    // and prev[c] the last span and the coverage before it.
+    std::vector<uint64_t> cost(query_len + 1, UINT64_MAX);
+    std::vector<uint64_t> from(query_len + 1), prev(query_len + 1);
+    cost[0] = 0;
+    for (size_t s = 0; s < spans.size(); s++) {
+      uint64_t end = spans[s].end;
+      for (uint64_t c = spans[s].begin; c < end; c++) {
+        if (cost[c] != UINT64_MAX && cost[c] + span_size(s) < cost[end]) {
+          cost[end] = cost[c] + span_size(s);
+          from[end] = s;
+          prev[end] = c;
+        }
+      }
+    }
+    std::vector<size_t> cover;
+    for (uint64_t c = query_len; c > 0; c = prev[c]) {
+      cover.push_back(from[c]);
+    }
+
+    // As for n-grams, the rarest span picks the candidates and the cover is
+    // intersected with them from its rarest span on.
+    std::sort(cover.begin(), cover.end(), [&](size_t a, size_t b) {
+      return span_size(a) < span_size(b);
+    });
+    size_t driver = 0;
+    for (size_t s = 1; s < spans.size(); s++) {
+      if (span_size(s) < span_size(driver))
+        driver = s;
+    }
+    // A query covered by its rarest span alone needs no intersection, so
+    // its offsets are left in key order. Room for the matches near the end
+    // of the text keeps appending them from copying the candidates.
+    bool sorted = cover.size() > 1 || cover[0] != driver;
+    results.reserve(span_size(driver) + query_len + max_len_);
+    decodeSpan(spans[driver], results, sorted);
+
+    std::vector<uint64_t> offsets;
+    for (auto s : cover) {
+      if (results.empty())
+        break;
+      if (s == driver)
+        continue;
+      if (spans[s].last - spans[s].first == 1) {
+        postings_->intersect(spans[s].first, spans[s].begin, results);
+        continue;
+      }
+      decodeSpan(spans[s], offsets, true);
+      size_t num_results = 0, j = 0;
+      for (auto offset : results) {
+        while (j < offsets.size() && offsets[j] < offset) {
+          j++;
+        }
+        if (j < offsets.size() && offsets[j] == offset)
+          results[num_results++] = offset;
+      }
+      results.resize(num_results);
+    }
+  }
+
+  // Matches followed by fewer than max_len_ - 1 characters may need a gram
+  // at an offset too close to the end to have one.
+  uint64_t tail = size_ + 2 > query_len + max_len_ ?
+      size_ + 2 - query_len - max_len_ : 0;
+  results.erase(std::remove_if(results.begin(), results.end(),
+                               [&](uint64_t offset) {
+                                 return offset >= tail;
+                               }), results.end());
+  for (uint64_t i = tail; i + query_len <= size_; i++) {
+    if (text_->matches(query.c_str(), i, query_len))
+      results.push_back(i);
+  }
+}
+
+void dsl::MultiGramIndex::search(std::vector<int64_t>& results,
+                                 const std::string& query) const {
+  if (query.empty() || !alphabet_.containsAll(query))
+    return;
+
+  std::vector<uint64_t> offsets;
+  locate(query, offsets);
+  results.insert(results.end(), offsets.begin(), offsets.end());
+}
+
+int64_t dsl::MultiGramIndex::count(const std::string& query) const {
+  if (query.empty() || !alphabet_.containsAll(query))
+    return 0;
+
+  std::vector<uint64_t> offsets;
+  locate(query, offsets);
+  return offsets.size();
+}
+
+bool dsl::MultiGramIndex::contains(const std::string& query) const {
+  if (query.empty() || !alphabet_.containsAll(query))
+    return false;
+
+  std::vector<uint64_t> offsets;
+  locate(query, offsets);
+  return !offsets.empty();
+}
+
+char dsl::MultiGramIndex::charAt(uint64_t i) const {
+  return text_->charAt(i);
+}
+
+void dsl::MultiGramIndex::compressText() {
+  if (text_->type() == TextStore::kCompressed)
+    return;
+  TextStore *text = new CompressedTextStore(text_->data(), size_);
+  delete text_;
+  text_ = text;
+}
+
+size_t dsl::MultiGramIndex::serialize(std::ostream& out) {
+  size_t out_size = 0;
+
+  out_size += TextStore::writeStore(out, text_);
+
+  out.write(reinterpret_cast<const char *>(&max_postings_), sizeof(uint64_t));
+  out_size += sizeof(uint64_t);
+
+  out_size += alphabet_.serialize(out);
+
+  uint64_t num_keys = keys_.size();
+  out.write(reinterpret_cast<const char *>(&num_keys), sizeof(uint64_t));
+  out_size += sizeof(uint64_t);
+
+  out.write(reinterpret_cast<const char *>(keys_.data()),
+            num_keys * sizeof(uint64_t));
+  out_size += num_keys * sizeof(uint64_t);
+
+  out_size += postings_->serialize(out);
+
+  return out_size;
+}
+
+size_t dsl::MultiGramIndex::deserialize(std::istream& in) {
+  size_t in_size = 0;
+
+  delete text_;
+  text_ = TextStore::readStore(in, &in_size);
+  size_ = text_->size();
+
+  in.read(reinterpret_cast<char *>(&max_postings_), sizeof(uint64_t));
+  in_size += sizeof(uint64_t);
+
+  in_size += alphabet_.deserialize(in);
+  bits_ = Utils::int_log_2(alphabet_.size() + 1);
+  max_len_ = 64 / bits_;
+
+  uint64_t num_keys;
+  in.read(reinterpret_cast<char *>(&num_keys), sizeof(uint64_t));
+  in_size += sizeof(uint64_t);
+
+  keys_.resize(num_keys);
+  in.read(reinterpret_cast<char *>(keys_.data()),
+          num_keys * sizeof(uint64_t));
+  in_size += num_keys * sizeof(uint64_t);
+
+  delete postings_;
+  postings_ = new CompressedPostings();
+  in_size += postings_->deserialize(in);
+
+  return in_size;
+}
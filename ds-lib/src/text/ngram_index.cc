@@ -1,179 +1,274 @@
 #include "text/ngram_index.h"
 
+#include <algorithm>
 #include <cassert>
+#include <unordered_map>
+
+#include "compressed_text_store.h"
 
 dsl::NGramIndex::NGramIndex() {
-  input_ = NULL;
+  text_ = NULL;
   size_ = 0;
   n_ = 0;
+  bits_ = 0;
+  postings_ = NULL;
 }
 
 dsl::NGramIndex::NGramIndex(const char *input, size_t size, uint32_t n) {
-  input_ = input;
+  text_ = new PlainTextStore(input, size);
   size_ = size;
   n_ = n;
-  constructNGramIndex();
+  postings_ = NULL;
+  constructNGramIndex(input);
 }
 
 dsl::NGramIndex::NGramIndex(const std::string& input, uint32_t n)
     : NGramIndex(input.c_str(), input.length(), n) {
 }
 
-void dsl::NGramIndex::constructNGramIndex() {
-  std::map<char *, std::vector<uint64_t>, ngram::NGramComparator> ngram_map(
-      (ngram::NGramComparator(n_)));
-  for (size_t i = 0; i < size_ - n_ + 1; i++) {
-    char* ngram = strndup(input_ + i, n_);
-    assert(ngram != NULL);
-    ngram_map[ngram].push_back(i);
+dsl::NGramIndex::~NGramIndex() {
+  delete text_;
+  delete postings_;
+}
+
+void dsl::NGramIndex::constructNGramIndex(const char* input) {
+  alphabet_ = Alphabet(input, size_);
+  bits_ = alphabet_.bitsPerSymbol();
+  if (n_ * bits_ > 64) {
+    fprintf(stderr, "%u-grams do not fit in 64 bits; using %u-grams.\n", n_,
+            64 / bits_);
+    n_ = 64 / bits_;
   }
 
-  uint8_t num_bits = Utils::int_log_2(size_ + 1);
-  map_ = NGramMap((ngram::NGramComparator(n_)));
-  for (auto& entry : ngram_map) {
-    map_[entry.first] = new BitmapArray(&entry.second[0], entry.second.size(), num_bits);
+  // One pass counts each distinct n-gram, a second places every offset in
+  // its n-gram's slice of the postings, which keeps them in text order.
+  uint64_t mask = keyMask();
+  std::unordered_map<uint64_t, uint64_t> slot;
+  uint64_t key = 0;
+  for (size_t i = 0; i < size_; i++) {
+    key = ((key << bits_) | alphabet_.encode(input[i])) & mask;
+    if (i + 1 >= n_)
+      slot[key]++;
   }
-  ngram_map.clear();
+
+  keys_.clear();
+  for (auto& entry : slot) {
+    keys_.push_back(entry.first);
+  }
+  std::sort(keys_.begin(), keys_.end());
+  std::vector<uint64_t> offsets(1, 0);
+  for (auto k : keys_) {
+    uint64_t count = slot[k];
+    slot[k] = offsets.back();
+    offsets.push_back(offsets.back() + count);
+  }
+
+  std::vector<uint64_t> postings(offsets.back());
+  key = 0;
+  for (size_t i = 0; i < size_; i++) {
+    key = ((key << bits_) | alphabet_.encode(input[i])) & mask;
+    if (i + 1 >= n_)
+      postings[slot[key]++] = i + 1 - n_;
+  }
+
+  delete postings_;
+  postings_ = new CompressedPostings(postings.data(), offsets);
 
 #ifdef DEBUG_CONSTRUCT
-  for (auto& entry : map_) {
-    fprintf(stderr, "[%s]: ", entry.first);
-    for (uint64_t i = 0; i < entry.second->num_elements_; i++) {
-      fprintf(stderr, "%llu, ", entry.second->at(i));
+  for (size_t k = 0; k < keys_.size(); k++) {
+    std::vector<uint64_t> offsets(postings_->size(k));
+    postings_->decode(k, offsets.data());
+    fprintf(stderr, "[%llx]: ", keys_[k]);
+    for (auto offset : offsets) {
+      fprintf(stderr, "%llu, ", offset);
     }
     fprintf(stderr, "\n");
   }
 #endif
 }
 
-bool dsl::NGramIndex::match(const char* str1, const char* str2, size_t len) const {
-  size_t pos = 0;
-  while(pos < len) {
-    if(str1[pos] != str2[pos]) return false;
-    pos++;
+std::pair<uint64_t, uint64_t> dsl::NGramIndex::getRange(
+    const std::string& query) const {
+  // Symbols missing from a short query are padded with the smallest and
+  // largest possible codes.
+  uint64_t lo = 0, hi = 0;
+  for (size_t i = 0; i < n_; i++) {
+    uint64_t lo_code = 0, hi_code = (1ULL << bits_) - 1;
+    if (i < query.length())
+      lo_code = hi_code = alphabet_.encode(query[i]);
+    lo = (lo << bits_) | lo_code;
+    hi = (hi << bits_) | hi_code;
   }
-  return true;
+  return std::make_pair(
+      std::lower_bound(keys_.begin(), keys_.end(), lo) - keys_.begin(),
+      std::upper_bound(keys_.begin(), keys_.end(), hi) - keys_.begin());
 }
 
-bool dsl::NGramIndex::nGramStartsWith(char* ngram, char *substr) const {
-  size_t pos = 0;
-#ifdef DEBUG_QUERY
-  fprintf(stderr, "%s starts with %s?\n", ngram, substr);
-#endif
-  while (substr[pos] != '\0') {
-    if (substr[pos] != ngram[pos])
-      return false;
-    pos++;
+uint64_t dsl::NGramIndex::keyMask() const {
+  return (n_ * bits_ == 64) ? ~0ULL : (1ULL << (n_ * bits_)) - 1;
+}
+
+uint64_t dsl::NGramIndex::tailStart() const {
+  return size_ < n_ ? 0 : size_ - n_ + 1;
+}
+
+void dsl::NGramIndex::locateLong(const std::string& query,
+                                 std::vector<uint64_t>& results) const {
+  size_t num_grams = query.length() - n_ + 1;
+  std::vector<uint64_t> lists(num_grams);
+  uint64_t key = 0;
+  for (size_t i = 0; i < query.length(); i++) {
+    key = ((key << bits_) | alphabet_.encode(query[i])) & keyMask();
+    if (i + 1 < n_)
+      continue;
+    auto it = std::lower_bound(keys_.begin(), keys_.end(), key);
+    if (it == keys_.end() || *it != key)
+      return;
+    lists[i + 1 - n_] = it - keys_.begin();
+  }
+
+  // The n-grams at offsets 0, n, 2n, ... and the last one cover every
+  // character of the query, so the offsets where all of them occur are
+  // exactly its matches. The rarest n-gram of the query, covering or not,
+  // picks the candidates, and the others are intersected with them from
+  // the rarest on.
+  std::vector<size_t> cover;
+  for (size_t i = 0; i < num_grams; i += n_) {
+    cover.push_back(i);
+  }
+  if (cover.back() != num_grams - 1)
+    cover.push_back(num_grams - 1);
+  auto rarer = [&](size_t a, size_t b) {
+    return postings_->size(lists[a]) < postings_->size(lists[b]);
+  };
+  std::sort(cover.begin(), cover.end(), rarer);
+  size_t driver = 0;
+  for (size_t i = 1; i < num_grams; i++) {
+    if (rarer(i, driver))
+      driver = i;
+  }
+
+  results.resize(postings_->size(lists[driver]));
+  postings_->decode(lists[driver], results.data());
+  size_t num_results = 0;
+  for (auto offset : results) {
+    if (offset >= driver)
+      results[num_results++] = offset - driver;
+  }
+  results.resize(num_results);
+
+  for (auto i : cover) {
+    if (results.empty())
+      break;
+    if (i != driver)
+      postings_->intersect(lists[i], i, results);
   }
-  return true;
 }
 
 void dsl::NGramIndex::search(std::vector<int64_t>& results,
                              const std::string& query) const {
-  char* query_str = (char *) query.c_str();
+  if (!alphabet_.containsAll(query))
+    return;
+
   size_t query_len = query.length();
-  if (query_len == n_) {
-    // Exact match, return matched results
-    if (map_.find(query_str) == map_.end())
-      return;
-    BitmapArray *res_exact = map_.at(query_str);
-    for (uint64_t i = 0; i < res_exact->num_elements_; i++) {
-      results.push_back(res_exact->at(i));
-    }
-  } else if (query_len < n_) {
-    // Query is smaller than n, aggregate results from multiple entries
-    auto it = map_.lower_bound(query_str);
-    while (it != map_.end() && nGramStartsWith(it->first, query_str)) {
-      BitmapArray *res_partial = it->second;
-      for (uint64_t i = 0; i < res_partial->num_elements_; i++) {
-        results.push_back(res_partial->at(i));
-      }
-      it++;
-    }
-  } else {
-    // Query is larger than n, must filter out results from ngram index
-    if (map_.find(query_str) == map_.end())
-      return;
-    size_t len_extra = strlen(query_str);
-    BitmapArray *res_extra = map_.at(query_str);
-    for (uint64_t i = 0; i < res_extra->num_elements_; i++) {
-      uint64_t offset = res_extra->at(i);
-      if (match(query_str + n_, input_ + offset + n_, query_len - n_))
-        results.push_back(offset);
-    }
+  if (query_len > n_) {
+    std::vector<uint64_t> offsets;
+    locateLong(query, offsets);
+    results.insert(results.end(), offsets.begin(), offsets.end());
+    return;
+  }
+
+  auto range = getRange(query);
+  static_assert(sizeof(uint64_t) == sizeof(int64_t), "offsets are 64 bits");
+  for (uint64_t k = range.first; k < range.second; k++) {
+    size_t pos = results.size();
+    results.resize(pos + postings_->size(k));
+    postings_->decode(k, reinterpret_cast<uint64_t *>(&results[pos]));
+  }
+
+  // Queries shorter than n may also start past the last full n-gram
+  for (uint64_t i = tailStart(); query_len < n_ && i + query_len <= size_;
+      i++) {
+    if (text_->matches(query.c_str(), i, query_len))
+      results.push_back(i);
   }
 }
 
 int64_t dsl::NGramIndex::count(const std::string& query) const {
-  char* query_str = (char *) query.c_str();
+  if (!alphabet_.containsAll(query))
+    return 0;
+
   size_t query_len = query.length();
-  int64_t count;
-  if (query_len == n_) {
-    // Exact match, return matched results
-    if (map_.find(query_str) == map_.end())
-      return 0;
-    BitmapArray *res_exact = map_.at(query_str);
-    count = res_exact->num_elements_;
-  } else if (query_len < n_) {
-    // Query is smaller than n, aggregate results from multiple entries
-    auto it = map_.lower_bound(query_str);
-    while (nGramStartsWith(it->first, query_str)) {
-      BitmapArray *res_partial = it->second;
-      count += res_partial->num_elements_;
-      it++;
-    }
-  } else {
-    // Query is larger than n, must filter out results from ngram index
-    if (map_.find(query_str) == map_.end())
-      return 0;
-    size_t len_extra = strlen(query_str);
-    BitmapArray *res_extra = map_.at(query_str);
-    for (uint64_t i = 0; i < res_extra->num_elements_; i++) {
-      uint64_t offset = res_extra->at(i);
-      if (std::strncmp(query_str + n_, input_ + offset + n_, query_len - n_)
-          == 0)
-        count++;
-    }
+  if (query_len > n_) {
+    std::vector<uint64_t> offsets;
+    locateLong(query, offsets);
+    return offsets.size();
+  }
+
+  auto range = getRange(query);
+  int64_t count = postings_->offset(range.second)
+      - postings_->offset(range.first);
+  for (uint64_t i = tailStart(); query_len < n_ && i + query_len <= size_;
+      i++) {
+    if (text_->matches(query.c_str(), i, query_len))
+      count++;
   }
   return count;
 }
 
 bool dsl::NGramIndex::contains(const std::string& query) const {
-  char* query_str = (char *) query.c_str();
+  if (!alphabet_.containsAll(query))
+    return false;
+
   size_t query_len = query.length();
-  if (query_len >= n_) {
-    return map_.find(query_str) != map_.end();
+  if (query_len > n_) {
+    std::vector<uint64_t> offsets;
+    locateLong(query, offsets);
+    return !offsets.empty();
   }
-  auto it = map_.lower_bound(query_str);
-  return nGramStartsWith(it->first, query_str);
+
+  auto range = getRange(query);
+  if (range.first < range.second)
+    return true;
+  for (uint64_t i = tailStart(); query_len < n_ && i + query_len <= size_;
+      i++) {
+    if (text_->matches(query.c_str(), i, query_len))
+      return true;
+  }
+  return false;
 }
 
 char dsl::NGramIndex::charAt(uint64_t i) const {
-  return input_[i];
+  return text_->charAt(i);
+}
+
+void dsl::NGramIndex::compressText() {
+  if (text_->type() == TextStore::kCompressed)
+    return;
+  TextStore *text = new CompressedTextStore(text_->data(), size_);
+  delete text_;
+  text_ = text;
 }
 
 size_t dsl::NGramIndex::serialize(std::ostream& out) {
   size_t out_size = 0;
 
-  out.write(reinterpret_cast<const char *>(&size_), sizeof(uint64_t));
-  out_size += sizeof(uint64_t);
-
-  out.write(reinterpret_cast<const char *>(input_), size_ * sizeof(char));
-  out_size += size_ * sizeof(char);
+  out_size += TextStore::writeStore(out, text_);
 
   out.write(reinterpret_cast<const char *>(&n_), sizeof(uint32_t));
   out_size += sizeof(uint32_t);
 
-  size_t map_size = map_.size();
-  out.write(reinterpret_cast<const char *>(&map_size), sizeof(uint64_t));
+  out_size += alphabet_.serialize(out);
+
+  uint64_t num_keys = keys_.size();
+  out.write(reinterpret_cast<const char *>(&num_keys), sizeof(uint64_t));
   out_size += sizeof(uint64_t);
 
-  for (auto& entry : map_) {
-    out.write(reinterpret_cast<const char *>(entry.first), n_ * sizeof(char));
-    out_size += n_ * sizeof(char);
+  out.write(reinterpret_cast<const char *>(keys_.data()),
+            num_keys * sizeof(uint64_t));
+  out_size += num_keys * sizeof(uint64_t);
 
-    out_size += entry.second->serialize(out);
-  }
+  out_size += postings_->serialize(out);
 
   return out_size;
 }
@@ -181,38 +276,36 @@ size_t dsl::NGramIndex::serialize(std::ostream& out) {
 size_t dsl::NGramIndex::deserialize(std::istream& in) {
   size_t in_size = 0;
 
-  in.read(reinterpret_cast<char *>(&size_), sizeof(uint64_t));
-  in_size += sizeof(uint64_t);
-
-  char *input = new char[size_];
-  in.read(reinterpret_cast<char *>(input), size_ * sizeof(char));
-  in_size += size_ * sizeof(char);
-  input_ = input;
+  delete text_;
+  text_ = TextStore::readStore(in, &in_size);
+  size_ = text_->size();
 
   in.read(reinterpret_cast<char *>(&n_), sizeof(uint32_t));
   in_size += sizeof(uint32_t);
 
-  size_t map_size;
-  in.read(reinterpret_cast<char *>(&map_size), sizeof(uint64_t));
-  in_size += sizeof(uint64_t);
+  in_size += alphabet_.deserialize(in);
+  bits_ = alphabet_.bitsPerSymbol();
 
-  map_ = NGramMap((ngram::NGramComparator(n_)));
-  for (size_t i = 0; i < map_size; i++) {
-    char *ngram = new char[n_];
-    in.read(reinterpret_cast<char *>(ngram), n_ * sizeof(char));
-    in_size += n_ * sizeof(char);
+  uint64_t num_keys;
+  in.read(reinterpret_cast<char *>(&num_keys), sizeof(uint64_t));
+  in_size += sizeof(uint64_t);
 
-    BitmapArray *offsets = new BitmapArray();
-    in_size += offsets->deserialize(in);
+  keys_.resize(num_keys);
+  in.read(reinterpret_cast<char *>(keys_.data()),
+          num_keys * sizeof(uint64_t));
+  in_size += num_keys * sizeof(uint64_t);
 
-    map_[ngram] = offsets;
-  }
+  delete postings_;
+  postings_ = new CompressedPostings();
+  in_size += postings_->deserialize(in);
 
 #ifdef DEBUG_CONSTRUCT
-  for (auto& entry : map_) {
-    fprintf(stderr, "[%s]: ", entry.first);
-    for (uint64_t i = 0; i < entry.second->num_elements_; i++) {
-      fprintf(stderr, "%llu, ", entry.second->at(i));
+  for (size_t k = 0; k < keys_.size(); k++) {
+    std::vector<uint64_t> offsets(postings_->size(k));
+    postings_->decode(k, offsets.data());
+    fprintf(stderr, "[%llx]: ", keys_[k]);
+    for (auto offset : offsets) {
+      fprintf(stderr, "%llu, ", offset);
     }
     fprintf(stderr, "\n");
   }
@@ -0,0 +1,140 @@
+#include "text/scan_index.h"
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+#include "substring_search.h"
+#include "utils.h"
+
+dsl::ScanIndex::ScanIndex(uint32_t num_threads) {
+  input_ = NULL;
+  size_ = 0;
+  num_threads_ = num_threads;
+  if (num_threads_ == 0)
+    num_threads_ = MAX(std::thread::hardware_concurrency(), 1);
+}
+
+dsl::ScanIndex::ScanIndex(const char* input, size_t size,
+                          uint32_t num_threads)
+    : ScanIndex(num_threads) {
+  size_ = size;
+  input_ = new char[size_];
+  memcpy(input_, input, size_);
+  alphabet_ = Alphabet(input_, size_);
+}
+
+dsl::ScanIndex::ScanIndex(const std::string& input, uint32_t num_threads)
+    : ScanIndex(input.c_str(), input.length() + 1, num_threads) {
+}
+
+dsl::ScanIndex::~ScanIndex() {
+  delete[] input_;
+}
+
+uint64_t dsl::ScanIndex::numChunks(const std::string& query) const {
+  if (query.empty() || query.length() > size_
+      || !alphabet_.containsAll(query))
+    return 0;
+  uint64_t num_positions = size_ - query.length() + 1;
+  return (num_positions + kChunkSize - 1) / kChunkSize;
+}
+
+void dsl::ScanIndex::forEachChunk(
+    uint64_t num_chunks, const std::function<bool(uint64_t)>& task) const {
+  std::atomic<uint64_t> next_chunk(0);
+  std::atomic<bool> done(false);
+  auto worker = [&]() {
+    uint64_t chunk;
+    while (!done && (chunk = next_chunk++) < num_chunks) {
+      if (!task(chunk))
+        done = true;
+    }
+  };
+
+  uint64_t num_threads = MIN((uint64_t) num_threads_, num_chunks);
+  std::vector<std::thread> threads;
+  for (uint64_t i = 1; i < num_threads; i++) {
+    threads.push_back(std::thread(worker));
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+void dsl::ScanIndex::search(std::vector<int64_t>& results,
+                            const std::string& query) const {
+  uint64_t num_chunks = numChunks(query);
+  if (num_chunks == 1) {
+    SubstringSearch::findAll(results, input_, size_, 0, kChunkSize,
+                             query.c_str(), query.length());
+    return;
+  }
+
+  std::vector<std::vector<int64_t>> chunk_results(num_chunks);
+  forEachChunk(num_chunks, [&](uint64_t chunk) {
+    SubstringSearch::findAll(chunk_results[chunk], input_, size_,
+                             chunk * kChunkSize, (chunk + 1) * kChunkSize,
+                             query.c_str(), query.length());
+    return true;
+  });
+
+  for (auto& chunk_result : chunk_results) {
+    results.insert(results.end(), chunk_result.begin(), chunk_result.end());
+  }
+}
+
+int64_t dsl::ScanIndex::count(const std::string& query) const {
+  std::atomic<uint64_t> count(0);
+  forEachChunk(numChunks(query), [&](uint64_t chunk) {
+    count += SubstringSearch::count(input_, size_, chunk * kChunkSize,
+                                    (chunk + 1) * kChunkSize, query.c_str(),
+                                    query.length());
+    return true;
+  });
+  return count;
+}
+
+bool dsl::ScanIndex::contains(const std::string& query) const {
+  std::atomic<bool> found(false);
+  forEachChunk(numChunks(query), [&](uint64_t chunk) {
+    if (SubstringSearch::findFirst(input_, size_, chunk * kChunkSize,
+                                   (chunk + 1) * kChunkSize, query.c_str(),
+                                   query.length()) >= 0)
+      found = true;
+    return !found;
+  });
+  return found;
+}
+
+char dsl::ScanIndex::charAt(uint64_t i) const {
+  return input_[i];
+}
+
+size_t dsl::ScanIndex::serialize(std::ostream& out) {
+  size_t out_size = 0;
+
+  out.write(reinterpret_cast<const char *>(&size_), sizeof(uint64_t));
+  out_size += sizeof(uint64_t);
+
+  out.write(reinterpret_cast<const char *>(input_), size_ * sizeof(char));
+  out_size += size_ * sizeof(char);
+
+  return out_size;
+}
+
+size_t dsl::ScanIndex::deserialize(std::istream& in) {
+  size_t in_size = 0;
+
+  in.read(reinterpret_cast<char *>(&size_), sizeof(uint64_t));
+  in_size += sizeof(uint64_t);
+
+  delete[] input_;
+  input_ = new char[size_];
+  in.read(reinterpret_cast<char *>(input_), size_ * sizeof(char));
+  in_size += size_ * sizeof(char);
+  alphabet_ = Alphabet(input_, size_);
+
+  return in_size;
+}
@@ -0,0 +1,277 @@
+#include "text/sparse_suffix_array_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "substring_search.h"
+#include "utils.h"
+
+dsl::SparseSuffixArrayIndex::SparseSuffixArrayIndex() {
+  sa_ = NULL;
+  input_ = NULL;
+  size_ = 0;
+  setBoundaries("");
+}
+
+dsl::SparseSuffixArrayIndex::SparseSuffixArrayIndex(
+    const char* input, size_t size, const std::string& boundaries) {
+  size_ = size;
+  input_ = new char[size_];
+  memcpy(input_, input, size_);
+  alphabet_ = Alphabet(input_, size_);
+  setBoundaries(boundaries);
+  construct();
+}
+
+dsl::SparseSuffixArrayIndex::SparseSuffixArrayIndex(
+    const std::string& input, const std::string& boundaries)
+    : SparseSuffixArrayIndex(input.c_str(), input.length() + 1, boundaries) {
+}
+
+dsl::SparseSuffixArrayIndex::~SparseSuffixArrayIndex() {
+  delete sa_;
+  delete[] input_;
+}
+
+void dsl::SparseSuffixArrayIndex::setBoundaries(
+    const std::string& boundaries) {
+  boundaries_ = boundaries;
+  memset(is_boundary_, 0, sizeof(is_boundary_));
+  for (auto c : boundaries_) {
+    is_boundary_[(uint8_t) c] = true;
+  }
+}
+
+void dsl::SparseSuffixArrayIndex::construct() {
+  // Collect the sampled suffixes along with their first 8 bytes, so that
+  // most comparisons while sorting are resolved on a single word.
+  std::vector<std::pair<uint64_t, uint64_t>> suffixes;
+  for (uint64_t i = 0; i < size_; i++) {
+    if (i != 0 && !is_boundary_[(uint8_t) input_[i - 1]])
+      continue;
+    uint64_t key = 0;
+    for (uint64_t j = i; j < i + 8; j++) {
+      key = (key << 8) | (j < size_ ? (uint8_t) input_[j] : 0);
+    }
+    suffixes.push_back(std::pair<uint64_t, uint64_t>(key, i));
+  }
+
+  const char* input = input_;
+  uint64_t size = size_;
+  std::sort(suffixes.begin(), suffixes.end(),
+            [input, size](const std::pair<uint64_t, uint64_t>& a,
+                          const std::pair<uint64_t, uint64_t>& b) {
+    if (a.first != b.first)
+      return a.first < b.first;
+    uint64_t i = a.second, j = b.second;
+    if (i + 8 <= size && j + 8 <= size) {
+      i += 8;
+      j += 8;
+    }
+    while (i < size && j < size && input[i] == input[j]) {
+      i++;
+      j++;
+    }
+    if (j == size)
+      return false;
+    if (i == size)
+      return true;
+    return (uint8_t) input[i] < (uint8_t) input[j];
+  });
+
+  sa_ = new BitmapArray(suffixes.size(), Utils::int_log_2(size_ + 1));
+  for (uint64_t i = 0; i < suffixes.size(); i++) {
+    sa_->insert(i, suffixes[i].second);
+  }
+}
+
+int32_t dsl::SparseSuffixArrayIndex::compare(const char* query, size_t len,
+                                             uint64_t pos) const {
+  for (uint64_t i = 0; i < len; i++) {
+    if (pos + i >= size_)
+      return 1;
+    uint8_t q = query[i], t = input_[pos + i];
+    if (q != t)
+      return (int32_t) q - (int32_t) t;
+  }
+  return 0;
+}
+
+std::pair<int64_t, int64_t> dsl::SparseSuffixArrayIndex::getRange(
+    const char* query, size_t len) const {
+  int64_t lo = 0, hi = sa_->num_elements_;
+  while (lo < hi) {
+    int64_t mid = lo + (hi - lo) / 2;
+    if (compare(query, len, sa_->at(mid)) > 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  int64_t sp = lo;
+  hi = sa_->num_elements_;
+  while (lo < hi) {
+    int64_t mid = lo + (hi - lo) / 2;
+    if (compare(query, len, sa_->at(mid)) >= 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return std::pair<int64_t, int64_t>(sp, lo - 1);
+}
+
+// Returns the offset within the query right after its first boundary
+// character, or -1 if the query has no boundary character before its last
+// position. Every occurrence of such a query has a sampled suffix starting
+// at that offset.
+int64_t dsl::SparseSuffixArrayIndex::getAnchor(
+    const std::string& query) const {
+  for (size_t i = 0; i + 1 < query.length(); i++) {
+    if (is_boundary_[(uint8_t) query[i]])
+      return i + 1;
+  }
+  return -1;
+}
+
+bool dsl::SparseSuffixArrayIndex::matchAt(const char* query, size_t len,
+                                          uint64_t pos) const {
+  return pos + len <= size_ && memcmp(query, input_ + pos, len) == 0;
+}
+
+void dsl::SparseSuffixArrayIndex::search(std::vector<int64_t>& results,
+                                         const std::string& query) const {
+  if (!alphabet_.containsAll(query))
+    return;
+
+  int64_t anchor = getAnchor(query);
+  if (anchor < 0) {
+    SubstringSearch::findAll(results, input_, size_, 0, size_, query.c_str(),
+                             query.length());
+    return;
+  }
+
+  std::pair<int64_t, int64_t> range = getRange(query.c_str() + anchor,
+                                               query.length() - anchor);
+  for (int64_t i = range.first; i <= range.second; i++) {
+    uint64_t pos = sa_->at(i);
+    if (pos >= (uint64_t) anchor
+        && matchAt(query.c_str(), anchor, pos - anchor))
+      results.push_back(pos - anchor);
+  }
+}
+
+int64_t dsl::SparseSuffixArrayIndex::count(const std::string& query) const {
+  if (!alphabet_.containsAll(query))
+    return 0;
+
+  int64_t anchor = getAnchor(query);
+  if (anchor < 0)
+    return SubstringSearch::count(input_, size_, 0, size_, query.c_str(),
+                                  query.length());
+
+  int64_t count = 0;
+  std::pair<int64_t, int64_t> range = getRange(query.c_str() + anchor,
+                                               query.length() - anchor);
+  for (int64_t i = range.first; i <= range.second; i++) {
+    uint64_t pos = sa_->at(i);
+    if (pos >= (uint64_t) anchor
+        && matchAt(query.c_str(), anchor, pos - anchor))
+      count++;
+  }
+  return count;
+}
+
+bool dsl::SparseSuffixArrayIndex::contains(const std::string& query) const {
+  if (!alphabet_.containsAll(query))
+    return false;
+
+  int64_t anchor = getAnchor(query);
+  if (anchor < 0) {
+    // A match at a boundary is found without touching the text.
+    std::pair<int64_t, int64_t> range = getRange(query.c_str(),
+                                                 query.length());
+    if (range.second >= range.first)
+      return true;
+    return SubstringSearch::findFirst(input_, size_, 0, size_, query.c_str(),
+                                      query.length()) >= 0;
+  }
+
+  std::pair<int64_t, int64_t> range = getRange(query.c_str() + anchor,
+                                               query.length() - anchor);
+  for (int64_t i = range.first; i <= range.second; i++) {
+    uint64_t pos = sa_->at(i);
+    if (pos >= (uint64_t) anchor
+        && matchAt(query.c_str(), anchor, pos - anchor))
+      return true;
+  }
+  return false;
+}
+
+void dsl::SparseSuffixArrayIndex::searchAnchored(
+    std::vector<int64_t>& results, const std::string& query) const {
+  std::pair<int64_t, int64_t> range = getRange(query.c_str(), query.length());
+  for (int64_t i = range.first; i <= range.second; i++) {
+    results.push_back(sa_->at(i));
+  }
+}
+
+int64_t dsl::SparseSuffixArrayIndex::countAnchored(
+    const std::string& query) const {
+  std::pair<int64_t, int64_t> range = getRange(query.c_str(), query.length());
+  return range.second - range.first + 1;
+}
+
+char dsl::SparseSuffixArrayIndex::charAt(uint64_t i) const {
+  return input_[i];
+}
+
+size_t dsl::SparseSuffixArrayIndex::serialize(std::ostream& out) {
+  size_t out_size = 0;
+
+  out.write(reinterpret_cast<const char *>(&size_), sizeof(uint64_t));
+  out_size += sizeof(uint64_t);
+
+  out.write(reinterpret_cast<const char *>(input_), size_ * sizeof(char));
+  out_size += size_ * sizeof(char);
+
+  uint64_t num_boundaries = boundaries_.length();
+  out.write(reinterpret_cast<const char *>(&num_boundaries), sizeof(uint64_t));
+  out_size += sizeof(uint64_t);
+
+  out.write(boundaries_.c_str(), num_boundaries * sizeof(char));
+  out_size += num_boundaries * sizeof(char);
+
+  out_size += sa_->serialize(out);
+  out_size += alphabet_.serialize(out);
+
+  return out_size;
+}
+
+size_t dsl::SparseSuffixArrayIndex::deserialize(std::istream& in) {
+  size_t in_size = 0;
+
+  in.read(reinterpret_cast<char *>(&size_), sizeof(uint64_t));
+  in_size += sizeof(uint64_t);
+
+  delete[] input_;
+  input_ = new char[size_];
+  in.read(reinterpret_cast<char *>(input_), size_ * sizeof(char));
+  in_size += size_ * sizeof(char);
+
+  uint64_t num_boundaries;
+  in.read(reinterpret_cast<char *>(&num_boundaries), sizeof(uint64_t));
+  in_size += sizeof(uint64_t);
+
+  std::string boundaries(num_boundaries, '\0');
+  in.read(&boundaries[0], num_boundaries * sizeof(char));
+  in_size += num_boundaries * sizeof(char);
+  setBoundaries(boundaries);
+
+  delete sa_;
+  sa_ = new BitmapArray();
+  in_size += sa_->deserialize(in);
+  in_size += alphabet_.deserialize(in);
+
+  return in_size;
+}
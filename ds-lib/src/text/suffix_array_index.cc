@@ -2,25 +2,37 @@
 
 #include <math.h>
 #include <climits>
+#include <cstring>
 #include <iostream>
 
+#include "compressed_text_store.h"
 #include "utils.h"
 
 dsl::SuffixArrayIndex::SuffixArrayIndex() {
   sa_ = NULL;
-  input_ = NULL;
+  text_ = NULL;
   size_ = 0;
+  range_search_type_ = kBinarySearch;
+  buckets_ = NULL;
+  model_ = NULL;
+  trie_ = NULL;
 }
 
 dsl::SuffixArrayIndex::SuffixArrayIndex(const char *input, size_t size,
                                         SuffixArray* suffix_array) {
   sa_ = suffix_array;
-  input_ = input;
+  text_ = new PlainTextStore(input, size);
   size_ = size;
+  alphabet_ = Alphabet(input, size);
+  range_search_type_ = kBinarySearch;
+  buckets_ = NULL;
+  model_ = NULL;
+  trie_ = NULL;
 }
 
 dsl::SuffixArrayIndex::SuffixArrayIndex(const char *input, size_t size)
-    : SuffixArrayIndex(input, size, new dsl::SuffixArray(input, size)) {
+    : SuffixArrayIndex(input, size, NULL) {
+  sa_ = new dsl::SuffixArray(input, size, alphabet_);
 }
 
 dsl::SuffixArrayIndex::SuffixArrayIndex(const std::string& input,
@@ -33,19 +45,28 @@ dsl::SuffixArrayIndex::SuffixArrayIndex(const std::string& input)
     : SuffixArrayIndex(input.c_str(), input.length() + 1) {
 }
 
+dsl::SuffixArrayIndex::~SuffixArrayIndex() {
+  delete trie_;
+  delete model_;
+  delete buckets_;
+  delete text_;
+  delete sa_;
+}
+
 int32_t dsl::SuffixArrayIndex::compare(const std::string& query,
                                        uint64_t pos) const {
   for (uint64_t i = pos, q_pos = 0; i < pos + query.length(); i++, q_pos++) {
-    if (input_[i % size_] != query[q_pos])
-      return query[q_pos] - input_[i % size_];
+    char c = text_->charAt(i % size_);
+    if (c != query[q_pos])
+      return query[q_pos] - c;
   }
   return 0;
 }
 
-std::pair<int64_t, int64_t> dsl::SuffixArrayIndex::getRange(
-    const std::string& query) const {
-  int64_t st = size_ - 1;
-  int64_t sp = 0;
+std::pair<int64_t, int64_t> dsl::SuffixArrayIndex::binarySearch(
+    const std::string& query, int64_t lo, int64_t hi) const {
+  int64_t st = hi;
+  int64_t sp = lo;
   int64_t s;
   while (sp < st) {
     s = (sp + st) / 2;
@@ -55,12 +76,12 @@ std::pair<int64_t, int64_t> dsl::SuffixArrayIndex::getRange(
       st = s;
   }
 
-  int64_t et = size_ - 1;
+  int64_t et = hi - 1;
   int64_t ep = sp - 1;
   int64_t e;
 
   while (ep < et) {
-    e = ceil((double) (ep + et) / 2);
+    e = ep + (et - ep + 1) / 2;
     if (compare(query, sa_->at(e)) == 0)
       ep = e;
     else
@@ -70,6 +91,129 @@ std::pair<int64_t, int64_t> dsl::SuffixArrayIndex::getRange(
   return std::pair<int64_t, int64_t>(sp, ep);
 }
 
+uint64_t dsl::SuffixArrayIndex::prefixKey(uint64_t pos) const {
+  uint64_t key = 0;
+  for (uint64_t i = pos; i < pos + 8; i++) {
+    key = (key << 8) | (i < size_ ? (uint8_t) text_->charAt(i) : 0);
+  }
+  return key;
+}
+
+int64_t dsl::SuffixArrayIndex::lowerBound(uint64_t key) const {
+  if (range_search_type_ == kBucketSearch)
+    return buckets_->at(key >> 48);
+
+  // Start from the model's estimate and widen the window exponentially until
+  // it is known to contain the answer; usually the first step suffices.
+  int64_t n = size_;
+  int64_t pos = MIN(MAX(model_->predict(key), 0), n);
+  int64_t lo = pos, hi = pos;
+  int64_t step = model_->error() + 1;
+  while (lo > 0 && prefixKey(sa_->at(lo - 1)) >= key) {
+    lo = MAX(lo - step, 0);
+    step *= 2;
+  }
+  step = model_->error() + 1;
+  while (hi < n && prefixKey(sa_->at(hi)) < key) {
+    hi = MIN(hi + step, n);
+    step *= 2;
+  }
+
+  while (lo < hi) {
+    int64_t mid = lo + (hi - lo) / 2;
+    if (prefixKey(sa_->at(mid)) < key)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+std::pair<int64_t, int64_t> dsl::SuffixArrayIndex::getRange(
+    const std::string& query) const {
+  if (!alphabet_.containsAll(query))
+    return std::pair<int64_t, int64_t>(0, -1);
+
+  if (trie_ != NULL) {
+    uint64_t lb, rb;
+    uint32_t depth;
+    if (!trie_->find(query, &lb, &rb, &depth))
+      return std::pair<int64_t, int64_t>(0, -1);
+    if (depth == query.length())
+      return std::pair<int64_t, int64_t>(lb, rb - 1);
+    return binarySearch(query, lb, rb);
+  }
+
+  if (range_search_type_ == kBinarySearch)
+    return binarySearch(query, 0, size_);
+
+  // All suffixes starting with the query's first key_len bytes have prefix
+  // keys in [lo_key, hi_key].
+  size_t key_len = MIN(query.length(),
+                       range_search_type_ == kBucketSearch ? 2 : 8);
+  uint64_t lo_key = 0;
+  for (size_t i = 0; i < key_len; i++) {
+    lo_key |= (uint64_t) (uint8_t) query[i] << (56 - 8 * i);
+  }
+  uint64_t hi_key = lo_key | (key_len == 8 ? 0 : (~0ULL >> (8 * key_len)));
+
+  int64_t lo = lowerBound(lo_key);
+  int64_t hi = (hi_key == ~0ULL) ? size_ : lowerBound(hi_key + 1);
+
+  // The zero padding of keys is ambiguous only for queries containing '\0'.
+  if (key_len == query.length() && memchr(query.c_str(), 0, key_len) == NULL)
+    return std::pair<int64_t, int64_t>(lo, hi - 1);
+
+  return binarySearch(query, lo, hi);
+}
+
+void dsl::SuffixArrayIndex::buildBuckets() {
+  buckets_ = new BitmapArray(kNumBuckets + 1, Utils::int_log_2(size_ + 1));
+  uint64_t next = 0;
+  for (uint64_t i = 0; i < size_; i++) {
+    uint64_t bucket = prefixKey(sa_->at(i)) >> 48;
+    while (next <= bucket) {
+      buckets_->insert(next++, i);
+    }
+  }
+  while (next <= kNumBuckets) {
+    buckets_->insert(next++, size_);
+  }
+}
+
+void dsl::SuffixArrayIndex::buildModel() {
+  model_ = new PiecewiseLinearModel();
+  uint64_t prev_key = 0;
+  for (uint64_t i = 0; i < size_; i++) {
+    uint64_t key = prefixKey(sa_->at(i));
+    if (i == 0 || key != prev_key)
+      model_->add(key, i);
+    prev_key = key;
+  }
+  model_->finish();
+}
+
+void dsl::SuffixArrayIndex::setRangeSearchType(RangeSearchType type) {
+  if (type == kBucketSearch && buckets_ == NULL)
+    buildBuckets();
+  else if (type == kLearnedSearch && model_ == NULL)
+    buildModel();
+  range_search_type_ = type;
+}
+
+dsl::SuffixArrayIndex::RangeSearchType
+dsl::SuffixArrayIndex::getRangeSearchType() const {
+  return range_search_type_;
+}
+
+void dsl::SuffixArrayIndex::buildPrefixTrie(uint32_t max_depth,
+                                            uint64_t max_nodes) {
+  delete trie_;
+  trie_ = NULL;
+  if (max_depth > 0)
+    trie_ = new PrefixTrie(text_, sa_, size_, max_depth, max_nodes);
+}
+
 void dsl::SuffixArrayIndex::search(std::vector<int64_t>& results,
                                    const std::string& query) const {
   std::pair<int64_t, int64_t> range = getRange(query);
@@ -93,37 +237,85 @@ bool dsl::SuffixArrayIndex::contains(const std::string& query) const {
 }
 
 char dsl::SuffixArrayIndex::charAt(uint64_t i) const {
-  return input_[i];
+  return text_->charAt(i);
+}
+
+void dsl::SuffixArrayIndex::compressText() {
+  if (text_->type() == TextStore::kCompressed)
+    return;
+  TextStore *text = new CompressedTextStore(text_->data(), size_);
+  delete text_;
+  text_ = text;
 }
 
 size_t dsl::SuffixArrayIndex::serialize(std::ostream& out) {
   size_t out_size = 0;
 
-  out.write(reinterpret_cast<const char *>(&size_), sizeof(uint64_t));
-  out_size += sizeof(uint64_t);
-
-  out.write(reinterpret_cast<const char *>(input_), size_ * sizeof(char));
-  out_size += size_ * sizeof(char);
+  out_size += TextStore::writeStore(out, text_);
 
   out_size += sa_->serialize(out);
 
+  uint8_t range_search_type = range_search_type_;
+  out.write(reinterpret_cast<const char *>(&range_search_type),
+            sizeof(uint8_t));
+  out_size += sizeof(uint8_t);
+
+  if (range_search_type_ == kBucketSearch)
+    out_size += buckets_->serialize(out);
+  else if (range_search_type_ == kLearnedSearch)
+    out_size += model_->serialize(out);
+
+  out_size += alphabet_.serialize(out);
+
+  uint8_t has_trie = (trie_ != NULL);
+  out.write(reinterpret_cast<const char *>(&has_trie), sizeof(uint8_t));
+  out_size += sizeof(uint8_t);
+  if (has_trie)
+    out_size += trie_->serialize(out);
+
   return out_size;
 }
 
 size_t dsl::SuffixArrayIndex::deserialize(std::istream& in) {
   size_t in_size = 0;
 
-  in.read(reinterpret_cast<char *>(&size_), sizeof(uint64_t));
-  in_size += sizeof(uint64_t);
-  char *input = new char[size_];
-  in.read(reinterpret_cast<char *>(input), size_ * sizeof(char));
-  in_size += size_ * sizeof(char);
-
-  input_ = input;
+  delete text_;
+  text_ = TextStore::readStore(in, &in_size);
+  size_ = text_->size();
 
+  delete sa_;
   sa_ = new dsl::SuffixArray();
   in_size += sa_->deserialize(in);
 
+  uint8_t range_search_type;
+  in.read(reinterpret_cast<char *>(&range_search_type), sizeof(uint8_t));
+  in_size += sizeof(uint8_t);
+  range_search_type_ = (RangeSearchType) range_search_type;
+
+  delete buckets_;
+  buckets_ = NULL;
+  delete model_;
+  model_ = NULL;
+  if (range_search_type_ == kBucketSearch) {
+    buckets_ = new BitmapArray();
+    in_size += buckets_->deserialize(in);
+  } else if (range_search_type_ == kLearnedSearch) {
+    model_ = new PiecewiseLinearModel();
+    in_size += model_->deserialize(in);
+  }
+
+  in_size += alphabet_.deserialize(in);
+
+  uint8_t has_trie;
+  in.read(reinterpret_cast<char *>(&has_trie), sizeof(uint8_t));
+  in_size += sizeof(uint8_t);
+  delete trie_;
+  trie_ = NULL;
+  if (has_trie) {
+    trie_ = new PrefixTrie();
+    in_size += trie_->deserialize(in);
+  }
+
   return in_size;
 }
 
@@ -159,6 +351,11 @@ dsl::AugmentedSuffixArrayIndex::AugmentedSuffixArrayIndex(
     : AugmentedSuffixArrayIndex(input.c_str(), input.length() + 1) {
 }
 
+dsl::AugmentedSuffixArrayIndex::~AugmentedSuffixArrayIndex() {
+  delete lcp_l_;
+  delete lcp_r_;
+}
+
 void dsl::AugmentedSuffixArrayIndex::constructLcp() {
 
   uint64_t N = size_;
@@ -177,7 +374,7 @@ void dsl::AugmentedSuffixArrayIndex::constructLcp() {
     uint64_t pos = isa[i];
     uint64_t j = sa_->at(pos - 1);
     while (i + lcp_val < N - 1 && j + lcp_val < N - 1
-        && input_[i + lcp_val] == input_[j + lcp_val]) {
+        && text_->charAt(i + lcp_val) == text_->charAt(j + lcp_val)) {
       lcp_val++;
     }
     if (pos != 0) {
@@ -222,7 +419,7 @@ uint64_t dsl::AugmentedSuffixArrayIndex::precomputeLcp(uint64_t *lcp,
 uint64_t dsl::AugmentedSuffixArrayIndex::lcpStr(const std::string& query,
                                                 uint64_t i) const {
   for (uint64_t l = 0; l < query.length(); l++) {
-    if (input_[(i + l) % size_] != query[l])
+    if (text_->charAt((i + l) % size_) != query[l])
       return l;
   }
   return query.length();
@@ -251,7 +448,7 @@ int64_t dsl::AugmentedSuffixArrayIndex::getFirstOccurrence(
         m = lcp_r_->at(mp - 1);
       }
     }
-    if (m == query.length() || query[m] <= input_[sa_->at(mp) + m]) {
+    if (m == query.length() || query[m] <= text_->charAt((sa_->at(mp) + m) % size_)) {
       rp = mp;
       r = m;
     } else {
@@ -265,6 +462,19 @@ int64_t dsl::AugmentedSuffixArrayIndex::getFirstOccurrence(
 
 std::pair<int64_t, int64_t> dsl::AugmentedSuffixArrayIndex::getRange(
     const std::string& query) const {
+  if (!alphabet_.containsAll(query))
+    return std::pair<int64_t, int64_t>(0, -1);
+
+  // The LCP-LR search always starts from the whole array, so the trie only
+  // answers queries it covers completely.
+  if (trie_ != NULL) {
+    uint64_t lb, rb;
+    uint32_t depth;
+    if (!trie_->find(query, &lb, &rb, &depth))
+      return std::pair<int64_t, int64_t>(0, -1);
+    if (depth == query.length())
+      return std::pair<int64_t, int64_t>(lb, rb - 1);
+  }
 
   int64_t sp = getFirstOccurrence(query);
   std::string end_query = std::string(query);
@@ -288,6 +498,8 @@ size_t dsl::AugmentedSuffixArrayIndex::deserialize(std::istream& in) {
   size_t in_size = 0;
 
   in_size += SuffixArrayIndex::deserialize(in);
+  delete lcp_l_;
+  delete lcp_r_;
   lcp_l_ = new BitmapArray();
   lcp_r_ = new BitmapArray();
   in_size += lcp_l_->deserialize(in);
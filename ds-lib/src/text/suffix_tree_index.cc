@@ -4,42 +4,55 @@ dsl::SuffixTreeIndex::SuffixTreeIndex() {
   st_ = NULL;
 }
 
-dsl::SuffixTreeIndex::SuffixTreeIndex(const char* input, size_t size) {
-  st_ = new CompactSuffixTree(input, size);
+dsl::SuffixTreeIndex::SuffixTreeIndex(const char* input, size_t size,
+                                      uint32_t num_threads) {
+  alphabet_ = Alphabet(input, size);
+  st_ = CompactSuffixTree::create(input, size, num_threads);
 }
 
-dsl::SuffixTreeIndex::SuffixTreeIndex(const std::string& input)
-    : SuffixTreeIndex(input.c_str(), input.length() + 1) {
+dsl::SuffixTreeIndex::SuffixTreeIndex(const std::string& input,
+                                      uint32_t num_threads)
+    : SuffixTreeIndex(input.c_str(), input.length(), num_threads) {
 }
 
 void dsl::SuffixTreeIndex::search(std::vector<int64_t>& results, const std::string& query) const {
-  st::CompactNode* subtree_root = st_->walkTree(query);
-  if(subtree_root == NULL) return;
+  if (!alphabet_.containsAll(query)) return;
+  st::NodeId subtree_root = st_->walkTree(query);
+  if(subtree_root == st::kNoNode) return;
   st_->getOffsets(results, subtree_root);
 }
 
 int64_t dsl::SuffixTreeIndex::count(const std::string& query) const {
-  st::CompactNode* subtree_root = st_->walkTree(query);
-  if(subtree_root == NULL) return 0;
+  if (!alphabet_.containsAll(query)) return 0;
+  st::NodeId subtree_root = st_->walkTree(query);
+  if(subtree_root == st::kNoNode) return 0;
   return st_->countLeaves(subtree_root);
-  return 1;
 }
 
 bool dsl::SuffixTreeIndex::contains(const std::string& query) const {
-  return st_->walkTree(query) != NULL;
+  return alphabet_.containsAll(query) && st_->walkTree(query) != st::kNoNode;
+}
+
+void dsl::SuffixTreeIndex::matchingStatistics(
+    std::vector<int64_t>& lengths, const std::string& pattern) const {
+  st_->matchingStatistics(lengths, pattern);
 }
 
 char dsl::SuffixTreeIndex::charAt(uint64_t i) const {
   return st_->charAt(i);
 }
 
+void dsl::SuffixTreeIndex::compressText() {
+  st_->compressText();
+}
+
 size_t dsl::SuffixTreeIndex::serialize(std::ostream& out) {
-  return st_->serialize(out);
-  return 0;
+  size_t out_size = alphabet_.serialize(out);
+  return out_size + CompactSuffixTree::writeTree(out, st_);
 }
 
 size_t dsl::SuffixTreeIndex::deserialize(std::istream& in) {
-  st_ = new CompactSuffixTree();
-  return st_->deserialize(in);
-  return 0;
+  size_t in_size = alphabet_.deserialize(in);
+  st_ = CompactSuffixTree::readTree(in, &in_size);
+  return in_size;
 }
@@ -0,0 +1,116 @@
+#include "text_store.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "compressed_text_store.h"
+#include "utils.h"
+
+bool dsl::TextStore::matches(const char* str, uint64_t pos,
+                             uint64_t len) const {
+  if (pos + len > size_)
+    return false;
+  if (data_ != NULL)
+    return memcmp(str, data_ + pos, len) == 0;
+
+  char buf[CompressedTextStore::kBlockSize];
+  while (len > 0) {
+    uint64_t n = MIN(len, sizeof(buf));
+    decode(buf, pos, n);
+    if (memcmp(str, buf, n) != 0)
+      return false;
+    str += n;
+    pos += n;
+    len -= n;
+  }
+  return true;
+}
+
+size_t dsl::TextStore::writeStore(std::ostream& out, TextStore* store) {
+  size_t out_size = 0;
+
+  uint8_t type = store->type();
+  out.write(reinterpret_cast<const char *>(&type), sizeof(uint8_t));
+  out_size += sizeof(uint8_t);
+
+  out_size += store->serialize(out);
+
+  return out_size;
+}
+
+dsl::TextStore* dsl::TextStore::readStore(std::istream& in, size_t* in_size) {
+  uint8_t type;
+  in.read(reinterpret_cast<char *>(&type), sizeof(uint8_t));
+  *in_size += sizeof(uint8_t);
+
+  TextStore *store;
+  if (type == kPlain) {
+    store = new PlainTextStore();
+  } else if (type == kCompressed) {
+    store = new CompressedTextStore();
+  } else {
+    fprintf(stderr, "Unknown text store type %u.\n", type);
+    return NULL;
+  }
+
+  *in_size += store->deserialize(in);
+  return store;
+}
+
+dsl::PlainTextStore::PlainTextStore() {
+  owns_data_ = false;
+}
+
+dsl::PlainTextStore::PlainTextStore(const char* input, size_t size) {
+  char *data = new char[size];
+  memcpy(data, input, size);
+  data_ = data;
+  size_ = size;
+  owns_data_ = true;
+}
+
+dsl::PlainTextStore::~PlainTextStore() {
+  if (owns_data_)
+    delete[] data_;
+}
+
+dsl::TextStore::StoreType dsl::PlainTextStore::type() const {
+  return kPlain;
+}
+
+char dsl::PlainTextStore::decodeAt(uint64_t i) const {
+  return data_[i];
+}
+
+void dsl::PlainTextStore::decode(char* buf, uint64_t pos, uint64_t len) const {
+  memcpy(buf, data_ + pos, len);
+}
+
+size_t dsl::PlainTextStore::serialize(std::ostream& out) {
+  size_t out_size = 0;
+
+  out.write(reinterpret_cast<const char *>(&size_), sizeof(uint64_t));
+  out_size += sizeof(uint64_t);
+
+  out.write(data_, size_ * sizeof(char));
+  out_size += size_ * sizeof(char);
+
+  return out_size;
+}
+
+size_t dsl::PlainTextStore::deserialize(std::istream& in) {
+  size_t in_size = 0;
+
+  in.read(reinterpret_cast<char *>(&size_), sizeof(uint64_t));
+  in_size += sizeof(uint64_t);
+
+  if (owns_data_)
+    delete[] data_;
+  char *data = new char[size_];
+  in.read(data, size_ * sizeof(char));
+  in_size += size_ * sizeof(char);
+  data_ = data;
+  owns_data_ = true;
+
+  return in_size;
+}
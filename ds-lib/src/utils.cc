@@ -1,20 +1,16 @@
 #include "utils.h"
 
 // Returns the number of set bits in a 64 bit integer
+DSL_POPCNT_CLONES
 uint64_t dsl::Utils::popcount(uint64_t n) {
-    // TODO: Add support for hardware instruction
-    n -= (n >> 1) & m1;
-    n = (n & m2) + ((n >> 2) & m2);
-    n = (n + (n >> 4)) & m4;
-    return (n * h01) >> 56;
+    return __builtin_popcountll(n);
 }
 
 // Returns integer logarithm to the base 2
 uint32_t dsl::Utils::int_log_2(uint64_t n) {
-    // TODO: Add support for hardware instruction
-    uint32_t l = ISPOWOF2(n) ? 0 : 1;
-    while (n >>= 1) ++l;
-    return l;
+    if (n == 0)
+        return 1;
+    return 63 - __builtin_clzll(n) + (ISPOWOF2(n) ? 0 : 1);
 }
 
 // Returns a modulo n
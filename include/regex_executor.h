@@ -25,6 +25,10 @@ class RegExExecutor {
   const dsl::TextIndex *text_idx_;
   RegEx *regex_;
   std::set<OffsetLength> final_result_;
+
+  // Printable symbols (other than newline) that a Dot can match, restricted
+  // to those that occur in the text.
+  std::string dot_symbols_;
 };
 
 class BBExecutor : public RegExExecutor {
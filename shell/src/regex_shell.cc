@@ -11,6 +11,9 @@
 #include "text/text_index.h"
 #include "text/suffix_array_index.h"
 #include "text/ngram_index.h"
+#include "text/multigram_index.h"
+#include "text/sparse_suffix_array_index.h"
+#include "text/scan_index.h"
 #include "benchmark.h"
 
 void print_usage(char *exec) {
@@ -72,7 +75,12 @@ int main(int argc, char **argv) {
       text_idx_->serialize(out);
       out.close();
     } else if (data_structure == 1) {
-      text_idx_ = new dsl::CompressedSuffixTree(input_text, input_file);
+      text_idx_ = new dsl::CompressedSuffixTree(input_text);
+
+      // Serialize to disk for future use.
+      std::ofstream out(input_file + ".cst");
+      text_idx_->serialize(out);
+      out.close();
     } else if (data_structure == 2) {
       text_idx_ = new dsl::SuffixArrayIndex(input_text);
 
@@ -94,6 +102,22 @@ int main(int argc, char **argv) {
       std::ofstream out(input_file + ".ngm");
       text_idx_->serialize(out);
       out.close();
+    } else if (data_structure == 5) {
+      text_idx_ = new dsl::SparseSuffixArrayIndex(input_text);
+
+      // Serialize to disk for future use.
+      std::ofstream out(input_file + ".ssa");
+      text_idx_->serialize(out);
+      out.close();
+    } else if (data_structure == 6) {
+      text_idx_ = new dsl::ScanIndex(input_text);
+    } else if (data_structure == 7) {
+      text_idx_ = new dsl::MultiGramIndex(input_text);
+
+      // Serialize to disk for future use.
+      std::ofstream out(input_file + ".mgm");
+      text_idx_->serialize(out);
+      out.close();
     } else {
       fprintf(stderr, "Data structure %d not supported yet.\n", data_structure);
       exit(0);
@@ -105,11 +129,9 @@ int main(int argc, char **argv) {
       text_idx_->deserialize(input_stream);
       input_stream.close();
     } else if (data_structure == 1) {
-      std::ifstream input_stream(input_file);
-      const std::string input_text(
-          (std::istreambuf_iterator<char>(input_stream)),
-          std::istreambuf_iterator<char>());
-      text_idx_ = new dsl::CompressedSuffixTree(input_text, input_file, false);
+      std::ifstream input_stream(input_file + ".cst");
+      text_idx_ = new dsl::CompressedSuffixTree();
+      text_idx_->deserialize(input_stream);
       input_stream.close();
     } else if (data_structure == 2) {
       std::ifstream input_stream(input_file + ".sa");
@@ -126,6 +148,23 @@ int main(int argc, char **argv) {
       text_idx_ = new dsl::NGramIndex();
       text_idx_->deserialize(input_stream);
       input_stream.close();
+    } else if (data_structure == 5) {
+      std::ifstream input_stream(input_file + ".ssa");
+      text_idx_ = new dsl::SparseSuffixArrayIndex();
+      text_idx_->deserialize(input_stream);
+      input_stream.close();
+    } else if (data_structure == 6) {
+      std::ifstream input_stream(input_file);
+      const std::string input_text(
+          (std::istreambuf_iterator<char>(input_stream)),
+          std::istreambuf_iterator<char>());
+      text_idx_ = new dsl::ScanIndex(input_text);
+      input_stream.close();
+    } else if (data_structure == 7) {
+      std::ifstream input_stream(input_file + ".mgm");
+      text_idx_ = new dsl::MultiGramIndex();
+      text_idx_->deserialize(input_stream);
+      input_stream.close();
     } else {
       fprintf(stderr, "Data structure %d not supported yet.\n", data_structure);
       exit(0);
@@ -6,6 +6,13 @@ pull_star::RegExExecutor::RegExExecutor(const dsl::TextIndex *text_idx,
                                         RegEx *regex) {
   text_idx_ = text_idx;
   regex_ = regex;
+
+  for (char c = 32; c < 127; c++) {
+    if (c == '\n'
+        || (text_idx_ != NULL && !text_idx_->alphabet().contains(c)))
+      continue;
+    dot_symbols_ += c;
+  }
 }
 
 pull_star::RegExExecutor::~RegExExecutor() {
@@ -43,12 +50,7 @@ void pull_star::BBExecutor::compute(RegExResult& result, RegEx* regex) {
         case RegExPrimitiveType::Dot: {
           std::string primitive = ((RegExPrimitive *) regex)->getPrimitive();
           if (primitive == ".") {
-            primitive = "";
-            for (char c = 32; c < 127; c++) {
-              if (c == '\n')
-                continue;
-              primitive += c;
-            }
+            primitive = dot_symbols_;
           }
           for (auto c : primitive) {
             RegExPrimitive char_primitive(std::string(1, c));
@@ -285,10 +287,7 @@ void pull_star::PSFwdExecutor::compute(TokenSet &tokens, RegEx *regex) {
           break;
         }
         case RegExPrimitiveType::Dot: {
-          for (char c = 32; c < 127; c++) {
-            if (c == '\n')
-              continue;
-
+          for (char c : dot_symbols_) {
             std::string token = std::string(1, c);
             if (text_idx_->contains(token)) {
               tokens.insert(token);
@@ -364,9 +363,7 @@ void pull_star::PSFwdExecutor::regexConcat(TokenSet &concat_tokens,
           break;
         }
         case RegExPrimitiveType::Dot: {
-          for (char c = 32; c < 127; c++) {
-            if (c == '\n')
-              continue;
+          for (char c : dot_symbols_) {
             std::string token = left_token + c;
             if (text_idx_->contains(token)) {
               concat_tokens.insert(token);
@@ -445,10 +442,7 @@ void pull_star::PSBwdExecutor::compute(TokenSet &tokens, RegEx *regex) {
           break;
         }
         case RegExPrimitiveType::Dot: {
-          for (char c = 32; c < 127; c++) {
-            if (c == '\n')
-              continue;
-
+          for (char c : dot_symbols_) {
             std::string token = std::string(1, c);
             if (text_idx_->contains(token)) {
               tokens.insert(token);
@@ -524,9 +518,7 @@ void pull_star::PSBwdExecutor::regexConcat(TokenSet &concat_tokens,
           break;
         }
         case RegExPrimitiveType::Dot: {
-          for (char c = 32; c < 127; c++) {
-            if (c == '\n')
-              continue;
+          for (char c : dot_symbols_) {
             std::string token = c + right_token;
             if (text_idx_->contains(token)) {
               concat_tokens.insert(token);
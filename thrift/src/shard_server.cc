@@ -12,6 +12,9 @@
 #include "text/suffix_tree_index.h"
 #include "text/suffix_array_index.h"
 #include "text/ngram_index.h"
+#include "text/multigram_index.h"
+#include "text/sparse_suffix_array_index.h"
+#include "text/scan_index.h"
 
 using namespace ::apache::thrift;
 using namespace ::apache::thrift::protocol;
@@ -21,10 +24,11 @@ using namespace ::apache::thrift::server;
 class ShardHandler : virtual public pull_star_thrift::ShardIf {
  public:
   ShardHandler(std::string input_file, int data_structure, bool construct,
-               int executor_type) {
+               int executor_type, int sample_rate) {
     input_file_ = input_file;
     data_structure_ = data_structure;
     construct_ = construct;
+    sample_rate_ = sample_rate;
     text_idx_ = NULL;
     executor_type_ =
         static_cast<pull_star::RegularExpression::ExecutorType>(executor_type);
@@ -49,7 +53,12 @@ class ShardHandler : virtual public pull_star_thrift::ShardIf {
         out.close();
       } else if (data_structure_ == 1) {
         fprintf(stderr, "Constructing compressed suffix tree...\n");
-        text_idx_ = new dsl::CompressedSuffixTree(input_text, input_file_);
+        text_idx_ = new dsl::CompressedSuffixTree(input_text, sample_rate_);
+
+        // Serialize to disk for future use.
+        std::ofstream out(input_file_ + ".cst");
+        text_idx_->serialize(out);
+        out.close();
       } else if (data_structure_ == 2) {
         fprintf(stderr, "Constructing suffix array...\n");
         text_idx_ = new dsl::SuffixArrayIndex(input_text);
@@ -74,6 +83,25 @@ class ShardHandler : virtual public pull_star_thrift::ShardIf {
         std::ofstream out(input_file_ + ".ngm");
         text_idx_->serialize(out);
         out.close();
+      } else if (data_structure_ == 5) {
+        fprintf(stderr, "Constructing sparse suffix array...\n");
+        text_idx_ = new dsl::SparseSuffixArrayIndex(input_text);
+
+        // Serialize to disk for future use.
+        std::ofstream out(input_file_ + ".ssa");
+        text_idx_->serialize(out);
+        out.close();
+      } else if (data_structure_ == 6) {
+        fprintf(stderr, "Loading text for scan index...\n");
+        text_idx_ = new dsl::ScanIndex(input_text);
+      } else if (data_structure_ == 7) {
+        fprintf(stderr, "Constructing multigram index...\n");
+        text_idx_ = new dsl::MultiGramIndex(input_text);
+
+        // Serialize to disk for future use.
+        std::ofstream out(input_file_ + ".mgm");
+        text_idx_->serialize(out);
+        out.close();
       } else {
         fprintf(stderr, "Data structure %d not supported yet.\n",
                 data_structure_);
@@ -91,13 +119,9 @@ class ShardHandler : virtual public pull_star_thrift::ShardIf {
         input_stream.close();
       } else if (data_structure_ == 1) {
         fprintf(stderr, "Loading compressed suffix tree from file...\n");
-        std::ifstream input_stream(input_file_);
-        const std::string input_text(
-            (std::istreambuf_iterator<char>(input_stream)),
-            std::istreambuf_iterator<char>());
-        fprintf(stderr, "Read text of size = %zu bytes\n", input_text.length());
-        text_idx_ = new dsl::CompressedSuffixTree(input_text, input_file_,
-                                                  false);
+        std::ifstream input_stream(input_file_ + ".cst");
+        text_idx_ = new dsl::CompressedSuffixTree();
+        text_idx_->deserialize(input_stream);
         input_stream.close();
       } else if (data_structure_ == 2) {
         fprintf(stderr, "Loading suffix array from file...\n");
@@ -117,6 +141,26 @@ class ShardHandler : virtual public pull_star_thrift::ShardIf {
         text_idx_ = new dsl::NGramIndex();
         text_idx_->deserialize(input_stream);
         input_stream.close();
+      } else if (data_structure_ == 5) {
+        fprintf(stderr, "Loading sparse suffix array from file...\n");
+        std::ifstream input_stream(input_file_ + ".ssa");
+        text_idx_ = new dsl::SparseSuffixArrayIndex();
+        text_idx_->deserialize(input_stream);
+        input_stream.close();
+      } else if (data_structure_ == 6) {
+        fprintf(stderr, "Loading text for scan index...\n");
+        std::ifstream input_stream(input_file_);
+        const std::string input_text(
+            (std::istreambuf_iterator<char>(input_stream)),
+            std::istreambuf_iterator<char>());
+        text_idx_ = new dsl::ScanIndex(input_text);
+        input_stream.close();
+      } else if (data_structure_ == 7) {
+        fprintf(stderr, "Loading multigram index from file...\n");
+        std::ifstream input_stream(input_file_ + ".mgm");
+        text_idx_ = new dsl::MultiGramIndex();
+        text_idx_->deserialize(input_stream);
+        input_stream.close();
       } else {
         fprintf(stderr, "Data structure %d not supported yet.\n",
                 data_structure_);
@@ -147,6 +191,7 @@ class ShardHandler : virtual public pull_star_thrift::ShardIf {
   std::string input_file_;
   int data_structure_;
   bool construct_;
+  int sample_rate_;
   pull_star::RegularExpression::ExecutorType executor_type_;
 
 };
@@ -154,13 +199,13 @@ class ShardHandler : virtual public pull_star_thrift::ShardIf {
 void print_usage(char *exec) {
   fprintf(
       stderr,
-      "Usage: %s [-m mode] [-d data-structure] [-p port] [-e executor-type] [file]\n",
+      "Usage: %s [-m mode] [-d data-structure] [-p port] [-e executor-type] [-s sample-rate] [file]\n",
       exec);
 }
 
 int main(int argc, char **argv) {
 
-  if (argc < 2 || argc > 10) {
+  if (argc < 2 || argc > 12) {
     print_usage(argv[0]);
     return -1;
   }
@@ -173,7 +218,8 @@ int main(int argc, char **argv) {
 
   int c;
   uint32_t mode = 0, port = 11001, data_structure = 1, executor_type = 1;
-  while ((c = getopt(argc, argv, "m:d:p:e:")) != -1) {
+  uint32_t sample_rate = 0;
+  while ((c = getopt(argc, argv, "m:d:p:e:s:")) != -1) {
     switch (c) {
       case 'm':
         mode = atoi(optarg);
@@ -187,6 +233,9 @@ int main(int argc, char **argv) {
       case 'e':
         executor_type = atoi(optarg);
         break;
+      case 's':
+        sample_rate = atoi(optarg);
+        break;
       default:
         fprintf(stderr, "Unrecognized option %c.", c);
         exit(0);
@@ -202,7 +251,8 @@ int main(int argc, char **argv) {
   bool construct = (mode == 0) ? true : false;
 
   boost::shared_ptr<ShardHandler> handler(
-      new ShardHandler(filename, data_structure, construct, executor_type));
+      new ShardHandler(filename, data_structure, construct, executor_type,
+                       sample_rate));
   boost::shared_ptr<TProcessor> processor(
       new pull_star_thrift::ShardProcessor(handler));
   try {